@@ -20,26 +20,56 @@ void cleanup(int signum)
 /* This file represents the system clock for ease of calculations */
 int main(int argc, char* argv[])
 {
-	printf("Clock starting\n");
+	// tick length, OS_TICK_US=1000 runs 1000x faster than real time
+	long long period = get_env_option_int("OS_TICK_US", CLK_DEFAULT_PERIOD_US);
+	if (period < 1)
+	{
+		period = CLK_DEFAULT_PERIOD_US;
+	}
+
+	printf("Clock starting, tick=%lldus\n", period);
 	signal(SIGINT, cleanup);
-	int clk = 0;
-	//Create shared memory for one integer variable 4 bytes
-	shmid = shmget(SHKEY, 4, IPC_CREAT | 0644);
+	long long clk = 0;
+	//Create shared memory for the clock page
+	shmid = shmget(SHKEY, sizeof(clk_shared), IPC_CREAT | 0644);
 	if ((long)shmid == -1)
 	{
 		perror("Error in creating shm!");
 		exit(-1);
 	}
-	int* shmaddr = (int*)shmat(shmid, (void*)0, 0);
+	clk_shared* shmaddr = (clk_shared*)shmat(shmid, (void*)0, 0);
 	if ((long)shmaddr == -1)
 	{
 		perror("Error in attaching the shm in clock!");
 		exit(-1);
 	}
-	*shmaddr = clk; /* initialize shared memory */
+	/* initialize shared memory */
+	shmaddr->tick = clk;
+	shmaddr->epoch_us = monotonic_time_us();
+
+	// published last, readers wait for it
+	__atomic_store_n(&shmaddr->period_us, period, __ATOMIC_RELEASE);
+
 	while (1)
 	{
-		sleep(1);
-		(*shmaddr)++;
+		// sleep until the absolute time of the next tick so ticks never drift
+		long long next = shmaddr->epoch_us + (clk + 1) * period;
+
+		struct timespec ts;
+		ts.tv_sec = next / 1000000;
+		ts.tv_nsec = (next % 1000000) * 1000;
+
+		if (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) != 0)
+		{
+			// interrupted, try again
+			continue;
+		}
+
+		clk++;
+		__atomic_store_n(&shmaddr->tick, clk, __ATOMIC_RELEASE);
+
+		// wake everyone in waitForTick
+		__atomic_store_n(&shmaddr->tick_futex, (int)clk, __ATOMIC_RELEASE);
+		syscall(SYS_futex, &shmaddr->tick_futex, FUTEX_WAKE, INT_MAX, NULL, NULL, 0);
 	}
 }
@@ -0,0 +1,94 @@
+/*
+* Watches a running scheduler through its live metrics page (OS_METRICS=1).
+* Prints one line per sample and the dispatch latency histogram once the scheduler is done.
+*
+* Usage: ./metrics_reader.out [interval_ms=1000]
+*/
+
+#include "headers.h"
+#include "metrics.h"
+
+volatile sig_atomic_t stop_requested;
+
+void stop_handler(int signum) {
+	stop_requested = 1;
+}
+
+void print_sample(metrics_page* m, metrics_page* last) {
+	// rates over the sampling interval, the page only keeps the current tick
+	int ticks = m->tick - last->tick;
+	float arrivalRate = ticks > 0 ? (m->arrivals - last->arrivals) / (float)ticks : 0.f;
+	float terminationRate = ticks > 0 ? (m->terminations - last->terminations) / (float)ticks : 0.f;
+
+	printf("[Metrics] tick=%d ready=%d running=%d busy=%d/%d switches=%lld arrived=%lld/%d (%.2f/tick) finished=%lld (%.2f/tick) util=%.2f%%\n",
+		m->tick, m->ready_queue_length, m->running_pid, m->busy_cpus, m->cpus, m->context_switches,
+		m->arrivals, m->processes_count, arrivalRate, m->terminations, terminationRate, m->utilization * 100.f);
+}
+
+void print_latency_histogram(metrics_page* m) {
+	printf("[Metrics] Dispatch latency:\n");
+
+	for (int i = 0; i < METRICS_LATENCY_BUCKETS; i++) {
+		if (m->dispatch_latency[i] == 0) continue;
+
+		if (i == 0) {
+			printf("\t< 1 us\t%lld\n", m->dispatch_latency[i]);
+		}
+		else if (i == 1) {
+			printf("\t1 us\t%lld\n", m->dispatch_latency[i]);
+		}
+		else if (i == METRICS_LATENCY_BUCKETS - 1) {
+			printf("\t>= %d us\t%lld\n", 1 << (i - 1), m->dispatch_latency[i]);
+		}
+		else {
+			printf("\t%d-%d us\t%lld\n", 1 << (i - 1), (1 << i) - 1, m->dispatch_latency[i]);
+		}
+	}
+}
+
+int main(int argc, char** argv) {
+	int intervalMs = argc > 1 ? atoi(argv[1]) : 1000;
+	if (intervalMs < 1) {
+		printf("Usage: %s [interval_ms]\n", argv[0]);
+		return 1;
+	}
+
+	signal(SIGINT, stop_handler);
+
+	// the scheduler may not be up yet
+	metrics_page* page = metrics_attach(false);
+	if (!page) {
+		printf("[Metrics] Waiting for a scheduler with OS_METRICS=1...\n");
+
+		while (!page && !stop_requested) {
+			usleep(100000);
+			page = metrics_attach(false);
+		}
+
+		if (!page) return 0;
+	}
+
+	metrics_page current;
+	metrics_page last;
+
+	metrics_read(page, &last);
+
+	while (!stop_requested) {
+		usleep(intervalMs * 1000);
+
+		metrics_read(page, &current);
+		print_sample(&current, &last);
+
+		last = current;
+
+		if (!current.active) {
+			// final snapshot
+			break;
+		}
+	}
+
+	print_latency_histogram(&last);
+
+	metrics_detach(page, false);
+	return 0;
+}
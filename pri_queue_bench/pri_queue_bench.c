@@ -0,0 +1,315 @@
+/*
+* Microbenchmark for the ready queue engines.
+* Compares shared/pri_queue.h and shared/bucket_queue.h against the old sorted linked list
+* pri_queue replaced, and checks they all hand out values in the exact same order.
+*
+* Usage: ./pri_queue_bench.out [entries] [rounds], no arguments runs 10k and 100k entries
+*/
+
+#include "headers.h"
+#include "bucket_queue.h"
+
+#include <time.h>
+
+// ================================Legacy list queue================================
+// the O(n) ordered-insert list pri_queue used to be, kept here as the baseline
+
+typedef struct list_queue_node
+{
+	struct list_queue_node* next;
+	struct list_queue_node* prev;
+
+	int priority;
+	void* value;
+} list_queue_node;
+
+typedef struct list_queue
+{
+	struct list_queue_node* head;
+} list_queue;
+
+void list_queue_init(list_queue* q)
+{
+	q->head = 0;
+}
+
+void list_queue_free(list_queue* q)
+{
+	struct list_queue_node* n = q->head;
+	while (n)
+	{
+		struct list_queue_node* next = n->next;
+		free(n);
+		n = next;
+	}
+
+	q->head = 0;
+}
+
+void list_queue_enqueue(list_queue* q, int priority, void* value)
+{
+	struct list_queue_node* node = (struct list_queue_node*)malloc(sizeof(list_queue_node));
+	memset(node, 0, sizeof(list_queue_node));
+
+	node->priority = priority;
+	node->value = value;
+
+	if (!q->head)
+	{
+		q->head = node;
+		return;
+	}
+
+	struct list_queue_node* current = q->head;
+	while (current)
+	{
+		if (current->priority > priority)
+		{
+			node->next = current;
+			node->prev = current->prev;
+
+			if (current->prev)
+			{
+				current->prev->next = node;
+			}
+			current->prev = node;
+
+			if (current == q->head)
+			{
+				q->head = node;
+			}
+
+			return;
+		}
+
+		if (!current->next)
+		{
+			node->prev = current;
+			current->next = node;
+
+			return;
+		}
+
+		current = current->next;
+	}
+}
+
+int list_queue_dequeue(list_queue* q, void** value)
+{
+	if (!q->head)
+		return 0;
+
+	struct list_queue_node* n = q->head;
+
+	q->head = n->next;
+	if (q->head)
+	{
+		q->head->prev = 0;
+	}
+
+	if (value)
+	{
+		*value = n->value;
+	}
+
+	free(n);
+
+	return 1;
+}
+
+// ================================Benchmark================================
+
+typedef struct bench_result {
+	double seconds;
+
+	// sum of dequeued values in order, used to compare engines
+	unsigned long long checksum;
+} bench_result;
+
+double bench_now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// the list is O(n^2) (about 1 s at 20k entries here), bigger runs only compare heap & buckets
+#define BENCH_LIST_MAX_ENTRIES 20000
+
+// deterministic priorities, few distinct values so FIFO tie-breaking matters
+// (below 63, the churn re-enqueues with +1 and that has to stay in a bucket of its own)
+void bench_fill_priorities(int* priorities, int count) {
+	unsigned int seed = 12345;
+	for (int i = 0; i < count; i++) {
+		seed = seed * 1103515245 + 12345;
+		priorities[i] = (seed >> 16) % 63;
+	}
+}
+
+/// Fill, then SRTN-style churn (dequeue head, re-enqueue it), then drain
+bench_result bench_pri_queue(int* priorities, int count, int rounds) {
+	bench_result result = { 0 };
+
+	pri_queue q;
+	pri_queue_init(&q);
+
+	double start = bench_now();
+
+	for (int i = 0; i < count; i++) {
+		pri_queue_enqueue(&q, priorities[i], (void*)(long)i);
+	}
+
+	unsigned long long position = 1;
+	void* value = 0;
+	for (int i = 0; i < rounds; i++) {
+		pri_queue_dequeue(&q, &value);
+		result.checksum += position++ * (unsigned long long)(long)value;
+
+		pri_queue_enqueue(&q, priorities[(long)value] + 1, value);
+	}
+
+	while (pri_queue_dequeue(&q, &value)) {
+		result.checksum += position++ * (unsigned long long)(long)value;
+	}
+
+	result.seconds = bench_now() - start;
+
+	pri_queue_free(&q);
+	return result;
+}
+
+// what a bucket_queue holds, links are embedded like the scheduler's pcbs
+typedef struct bench_item {
+	long value;
+	intrusive_link link;
+} bench_item;
+
+bench_result bench_bucket_queue(int* priorities, int count, int rounds) {
+	bench_result result = { 0 };
+
+	bench_item* items = malloc(sizeof(bench_item) * count);
+
+	bucket_queue q;
+	bucket_queue_init(&q);
+
+	double start = bench_now();
+
+	for (int i = 0; i < count; i++) {
+		items[i].value = i;
+		intrusive_link_init(&items[i].link);
+
+		bucket_queue_push(&q, priorities[i], &items[i].link);
+	}
+
+	unsigned long long position = 1;
+	intrusive_link* link;
+	for (int i = 0; i < rounds; i++) {
+		bench_item* item = intrusive_list_entry(bucket_queue_pop(&q), bench_item, link);
+		result.checksum += position++ * (unsigned long long)item->value;
+
+		bucket_queue_push(&q, priorities[item->value] + 1, &item->link);
+	}
+
+	while ((link = bucket_queue_pop(&q))) {
+		result.checksum += position++ * (unsigned long long)intrusive_list_entry(link, bench_item, link)->value;
+	}
+
+	result.seconds = bench_now() - start;
+
+	free(items);
+	return result;
+}
+
+bench_result bench_list_queue(int* priorities, int count, int rounds) {
+	bench_result result = { 0 };
+
+	list_queue q;
+	list_queue_init(&q);
+
+	double start = bench_now();
+
+	for (int i = 0; i < count; i++) {
+		list_queue_enqueue(&q, priorities[i], (void*)(long)i);
+	}
+
+	unsigned long long position = 1;
+	void* value = 0;
+	for (int i = 0; i < rounds; i++) {
+		list_queue_dequeue(&q, &value);
+		result.checksum += position++ * (unsigned long long)(long)value;
+
+		list_queue_enqueue(&q, priorities[(long)value] + 1, value);
+	}
+
+	while (list_queue_dequeue(&q, &value)) {
+		result.checksum += position++ * (unsigned long long)(long)value;
+	}
+
+	result.seconds = bench_now() - start;
+
+	list_queue_free(&q);
+	return result;
+}
+
+/// Runs every engine on the same workload, 0 if their dequeue orders differ
+int run_bench(int count, int rounds) {
+	int* priorities = malloc(sizeof(int) * count);
+	bench_fill_priorities(priorities, count);
+
+	printf("[Bench] entries=%d rounds=%d\n", count, rounds);
+
+	bench_result heap = bench_pri_queue(priorities, count, rounds);
+	printf("heap pri_queue:   %10.3f ms\n", heap.seconds * 1000.0);
+
+	bench_result buckets = bench_bucket_queue(priorities, count, rounds);
+	printf("bucket_queue:     %10.3f ms\n", buckets.seconds * 1000.0);
+
+	if (heap.checksum != buckets.checksum) {
+		printf("[Bench] ORDER MISMATCH heap=%llu buckets=%llu\n", heap.checksum, buckets.checksum);
+		free(priorities);
+		return 0;
+	}
+
+	if (count > BENCH_LIST_MAX_ENTRIES) {
+		printf("legacy list:      skipped (more than %d entries)\n", BENCH_LIST_MAX_ENTRIES);
+		printf("[Bench] same dequeue order, buckets %.1fx heap\n", heap.seconds / buckets.seconds);
+
+		free(priorities);
+		return 1;
+	}
+
+	bench_result list = bench_list_queue(priorities, count, rounds);
+	printf("legacy list:      %10.3f ms\n", list.seconds * 1000.0);
+
+	if (heap.checksum != list.checksum) {
+		printf("[Bench] ORDER MISMATCH heap=%llu list=%llu\n", heap.checksum, list.checksum);
+		free(priorities);
+		return 0;
+	}
+
+	printf("[Bench] same dequeue order, heap %.1fx list, buckets %.1fx heap\n", list.seconds / heap.seconds, heap.seconds / buckets.seconds);
+
+	free(priorities);
+	return 1;
+}
+
+int main(int argc, char** argv) {
+	if (argc == 1) {
+		// the sizes our traces reach
+		if (!run_bench(10000, 10000) || !run_bench(100000, 100000)) {
+			return 1;
+		}
+
+		return 0;
+	}
+
+	int count = atoi(argv[1]);
+	int rounds = argc > 2 ? atoi(argv[2]) : count;
+
+	if (count < 1 || rounds < 0) {
+		printf("Usage: %s [entries] [rounds]\n", argv[0]);
+		return 1;
+	}
+
+	return run_bench(count, rounds) ? 0 : 1;
+}
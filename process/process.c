@@ -1,19 +1,48 @@
 #include "headers.h"
 
 void continue_handler(int);
+void run_job(int remainingTime);
+void worker_loop(int index);
 
 int last_update_time;
 
-int main(int argc, char** argv) {
-	int remainingTime = atoi(argv[1]);
-
-	printf("[Process] %d started rt=%d\n", getpid(), remainingTime);
+// our slot in the scheduler's status table
+process_status* status;
+process_status* statusTable;
 
+int main(int argc, char** argv) {
 	// attach signals
 	signal(SIGCONT, continue_handler);
 
 	initClk();
 
+	// our remaining time is published here for the scheduler
+	statusTable = process_status_attach(0, false);
+	if (!statusTable) {
+		exit(-1);
+	}
+
+	if (argc > 2 && strcmp(argv[1], "-w") == 0) {
+		// pre-forked worker (OS_PROCESS_POOL), runs jobs until the scheduler shuts us down
+		worker_loop(atoi(argv[2]));
+	}
+	else {
+		status = &statusTable[atoi(argv[2])];
+
+		run_job(atoi(argv[1]));
+	}
+
+	process_status_detach(statusTable, false);
+	destroyClk(false);
+
+	// the scheduler reaps us on SIGCHLD
+	return 0;
+}
+
+/// Runs one process from its initial stop until its remaining time is used up
+void run_job(int remainingTime) {
+	printf("[Process] %d started rt=%d\n", getpid(), remainingTime);
+
 	// stay paused
 	raise(SIGTSTP);
 
@@ -23,6 +52,9 @@ int main(int argc, char** argv) {
 	last_update_time = getClk();
 
 	while (remainingTime > 0) {
+		// sleep until the next tick
+		waitForTick(last_update_time + 1);
+
 		int now = getClk();
 		if (now - last_update_time > 0) {
 			printf("PROC PID=%d delta=%d left=%d\n", getpid(), now - last_update_time, remainingTime);
@@ -31,25 +63,77 @@ int main(int argc, char** argv) {
 
 			remainingTime--;
 
-			// notify scheduler of decrement
-			kill(getppid(), SIGUSR2);
-		}
+			// publish the decrement, the scheduler reads it when it needs it
+			__atomic_store_n(&status->remaining_time, remainingTime, __ATOMIC_RELEASE);
+			__atomic_store_n(&status->updated_at, now, __ATOMIC_RELEASE);
 
-		// sleep for a bit
-		usleep(200 * 1000);
+			// the scheduler may be sleeping on it for this tick's decrement
+			syscall(SYS_futex, &status->updated_at, FUTEX_WAKE, 1, NULL, NULL, 0);
+		}
 	}
 
-	destroyClk(false);
 	printf("Process %d finished\n", getpid());
+}
 
-	// notify scheduler
-	kill(getppid(), SIGUSR1);
+/// Waits for jobs in our pool slot and runs them, the process is recycled instead of exiting
+void worker_loop(int index) {
+	process_pool_slot* slots = process_pool_attach(0, false);
+	if (!slots) {
+		exit(-1);
+	}
 
-	return 0;
+	process_pool_slot* slot = &slots[index];
+
+	// a pause racing with the end of a job must not stop us while idle
+	signal(SIGTSTP, SIG_IGN);
+
+	// we're attached to everything, jobs can come
+	int seen = __atomic_load_n(&slot->job_seq, __ATOMIC_ACQUIRE);
+	__atomic_store_n(&slot->ready, 1, __ATOMIC_RELEASE);
+
+	while (1) {
+		// sleep until the scheduler hands us a job
+		int seq;
+		while ((seq = __atomic_load_n(&slot->job_seq, __ATOMIC_ACQUIRE)) == seen) {
+			syscall(SYS_futex, &slot->job_seq, FUTEX_WAIT, seen, NULL, NULL, 0);
+		}
+
+		seen = seq;
+
+		if (slot->shutdown) {
+			break;
+		}
+
+		status = &statusTable[slot->status_slot];
+
+		signal(SIGTSTP, SIG_DFL);
+		run_job(slot->remaining_time);
+		signal(SIGTSTP, SIG_IGN);
+
+		// the slot belongs to the next job's process from now on
+		status = 0;
+
+		// we don't exit, so tell the scheduler which worker is free again
+		union sigval value;
+		value.sival_int = index;
+		sigqueue(getppid(), SIGNAL_PROCESS_DONE, value);
+	}
+
+	process_pool_detach(slots, false);
 }
 
 void continue_handler(int signum)
 {
 	printf("PROC %d received cont\n", getpid());
 	last_update_time = getClk();
-}
\ No newline at end of file
+
+	// an idle pool worker has no job (and no status slot) yet
+	if (!status)
+		return;
+
+	// this tick isn't ours to count
+	__atomic_store_n(&status->updated_at, last_update_time, __ATOMIC_RELEASE);
+
+	// the scheduler may be sleeping on it right after dispatching us
+	syscall(SYS_futex, &status->updated_at, FUTEX_WAKE, 1, NULL, NULL, 0);
+}
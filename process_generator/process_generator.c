@@ -1,17 +1,26 @@
 #include "headers.h"
 
+#include <sys/eventfd.h>
+
 void clear_resources(int);
 
-int read_processes(pri_queue* processes, int* count);
 void get_scheduler_data(int* chosenAlgorithm, int* quantum);
 
 int fork_clk(/* out */ pid_t* clkPid);
 int fork_scheduler(int algorithm, int quantum, int procCount, /* out */ pid_t* schedPid);
 
 int initialize_message_queue();
-int process_loop(pri_queue* processes, key_t clk_child);
+int initialize_ring();
+int process_loop(pri_queue* processes, pid_t schedulerPid);
+int send_processes(process_data* batch, int count, pid_t schedulerPid);
+
+key_t process_msgq_id = -1;
+
+int transport;
 
-key_t process_msgq_id;
+// ring transport, the scheduler inherits the eventfd and is told its number
+process_ring* arrival_ring;
+int arrival_event_fd = -1;
 
 int main(int argc, char* argv[]) {
 	// set interrupt handler
@@ -33,6 +42,22 @@ int main(int argc, char* argv[]) {
 	int quantum = -1;
 	get_scheduler_data(&schedAlgo, &quantum);
 
+	if (is_simulation_mode()) {
+		// the scheduler replays processes.txt on its own, no clock or transport needed
+		pid_t schedulerPid;
+		if (fork_scheduler(schedAlgo, quantum, procsCount, &schedulerPid)) {
+			waitpid(schedulerPid, NULL, 0);
+		}
+
+		goto exit;
+	}
+
+	// the ring has to exist before the scheduler attaches it
+	transport = get_process_transport();
+	if (transport == PROCESS_TRANSPORT_RING && !initialize_ring()) {
+		goto exit;
+	}
+
 	// fork scheduler
 	pid_t schedulerPid;
 	if (!fork_scheduler(schedAlgo, quantum, procsCount, &schedulerPid)) {
@@ -47,7 +72,7 @@ int main(int argc, char* argv[]) {
 
 	initClk();
 
-	if (!process_loop(&processesQueue, clkPid)) {
+	if (!process_loop(&processesQueue, schedulerPid)) {
 		perror("Error in process loop");
 		goto exit;
 	}
@@ -66,79 +91,47 @@ exit:
 void clear_resources(int signum) {
 	printf("[ProcGen] Cleaning up...\n");
 
-	msgctl(process_msgq_id, IPC_RMID, (struct msqid_ds*)0);
+	if (process_msgq_id != -1) {
+		msgctl(process_msgq_id, IPC_RMID, (struct msqid_ds*)0);
+	}
+
+	process_ring_detach(arrival_ring, true);
 	destroyClk(true);
 	exit(0);
 }
 
 void get_scheduler_data(int* algorithm, int* quantum) {
 	do {
-		printf("Choose a scheduling algorithm\n%d - HPF (Non-preemptive Highest Priority First)\n%d - SRTN (Shortest Remaining time Next)\n%d - RR (Round Robin)\nAlgorithm: ",
-			SCHEDULING_ALGO_HPF, SCHEDULING_ALGO_SRTN, SCHEDULING_ALGO_RR);
+		printf("Choose a scheduling algorithm\n%d - HPF (Highest Priority First)\n%d - SRTN (Shortest Remaining time Next)\n%d - RR (Round Robin)\n%d - MLFQ (Multi-level Feedback Queue)\n%d - CFS (Completely Fair Scheduler)\nAlgorithm: ",
+			SCHEDULING_ALGO_HPF, SCHEDULING_ALGO_SRTN, SCHEDULING_ALGO_RR, SCHEDULING_ALGO_MLFQ, SCHEDULING_ALGO_CFS);
 		scanf("%d", algorithm);
-	} while (*algorithm < 0 || *algorithm > 2);
+	} while (*algorithm < 0 || *algorithm > SCHEDULING_ALGO_CFS);
 
 
-	if (*algorithm == SCHEDULING_ALGO_RR) {
+	if (*algorithm == SCHEDULING_ALGO_HPF) {
+		// passed on as the quantum, HPF has no other use for it
+		do {
+			printf("Preemptive HPF (0 = no, 1 = yes): ");
+			if (scanf("%d", quantum) != 1) {
+				// no answer, keep the classic non-preemptive one
+				*quantum = 0;
+				break;
+			}
+		} while (*quantum != 0 && *quantum != 1);
+	}
+	else if (*algorithm == SCHEDULING_ALGO_RR) {
 		do {
 			printf("RR quantum: ");
 			scanf("%d", quantum);
 		} while (*quantum < 1);
 	}
-}
-
-int read_processes(pri_queue* processes, int* count) {
-	if (count) {
-		*count = 0;
-	}
-
-	if (!processes)
-		return 0;
-
-	FILE* f = fopen("processes.txt", "r");
-	if (!f)
-	{
-		// invalid file?
-		return 0;
-	}
-
-	char* line = 0;
-	size_t lineLen = 0;
-	while (getline(&line, &lineLen, f) != EOF)
-	{
-		// we have a line :P
-		// ignore empty lines or lines that start with #
-		if (lineLen == 0 ||
-			strlen(line) == 0 ||
-			line[0] == '#')
-			continue;
-
-		// allocate process
-		struct process_data* p = malloc(sizeof(process_data));
-		memset(p, 0, sizeof(process_data));
-
-		// read proc data
-		sscanf(line, "%d%d%d%d", &p->id, &p->arrival_time, &p->running_time, &p->priority);
-
-		// insert in queue
-		pri_queue_enqueue(processes, p->arrival_time, p);
-		printf("Process with id %d, arrivaltime %d, remainingtime %d, priority %d\n", p->id, p->arrival_time, p->running_time, p->priority);
-
-		if (count) {
-			(*count)++;
-		}
-	}
-
-	// close file
-	fclose(f);
-
-	// free line
-	if (line)
-	{
-		free(line);
+	else if (*algorithm == SCHEDULING_ALGO_MLFQ) {
+		// lower levels get longer quanta, see OS_MLFQ_QUANTA
+		do {
+			printf("MLFQ top level quantum: ");
+			scanf("%d", quantum);
+		} while (*quantum < 1);
 	}
-
-	return 1;
 }
 
 int fork_clk(/* out */ pid_t* clkPid) {
@@ -148,6 +141,10 @@ int fork_clk(/* out */ pid_t* clkPid) {
 		return 0;
 	}
 	else if (child == 0) {
+		if (arrival_event_fd != -1) {
+			close(arrival_event_fd);
+		}
+
 		execl("./clk.out", "clk.out", NULL);
 	}
 
@@ -162,13 +159,21 @@ int fork_scheduler(int algorithm, int quantum, int procCount, /* out */ pid_t* s
 		return 0;
 	}
 	else if (child == 0) {
+		// keep event signals blocked across exec, an early arrival must not kill the scheduler
+		sigset_t eventSignals;
+		scheduler_event_signals(&eventSignals);
+		sigprocmask(SIG_BLOCK, &eventSignals, NULL);
+
 		// alloc params
-		char params[3][10];
+		char params[4][10];
 		sprintf(params[0], "%d", algorithm);
 		sprintf(params[1], "%d", quantum);
 		sprintf(params[2], "%d", procCount);
 
-		execl("./scheduler.out", "scheduler.out", params[0], params[1], params[2], NULL);
+		// -1 = msg queue transport
+		sprintf(params[3], "%d", arrival_event_fd);
+
+		execl("./scheduler.out", "scheduler.out", params[0], params[1], params[2], params[3], NULL);
 	}
 
 	// parent
@@ -187,38 +192,95 @@ int initialize_message_queue() {
 	return 1;
 }
 
-int process_loop(pri_queue* processes, key_t clk_child) {
+int initialize_ring() {
+	arrival_ring = process_ring_attach(true);
+	if (!arrival_ring) {
+		return 0;
+	}
+
+	// inherited by the scheduler
+	arrival_event_fd = eventfd(0, 0);
+	if (arrival_event_fd == -1) {
+		perror("Error in create eventfd");
+		return 0;
+	}
+
+	return 1;
+}
+
+int process_loop(pri_queue* processes, pid_t schedulerPid) {
 	// Message Queue Generation to send the process data to the scheduler
-	if (!initialize_message_queue()) {
+	if (transport == PROCESS_TRANSPORT_MSGQ && !initialize_message_queue()) {
 		// error msg already printed
 		return 0;
 	}
 
-	process_message_buffer msgBuffer;
-	msgBuffer.type = 1;
+	process_data batch[PROCESS_BATCH_MAX];
 
 	process_data* proc = 0;
-	while (pri_queue_dequeue(processes, (void**)&proc))
+	while (pri_queue_peek(processes, (void**)&proc))
 	{
-		// keep waiting
-		while (proc->arrival_time > getClk())
+		// sleep until the next arrival tick
+		waitForTick(proc->arrival_time);
+
+		// everything that is due now goes out together
+		int now = getClk();
+		int count = 0;
+
+		while (count < PROCESS_BATCH_MAX && pri_queue_peek(processes, (void**)&proc) && proc->arrival_time <= now)
 		{
-			//printf("waiting for %d\n", proc->arrival_time - getClk());
+			pri_queue_dequeue(processes, 0);
+
+			printf("[ProcGen] %d - sending process with id %d and running time %d and arrivaltime  %d and priority %d\n", now, proc->id, proc->running_time, proc->arrival_time, proc->priority);
 
-			// sleep for 200ms
-			usleep(200 * 1000);
+			batch[count++] = *proc;
 		}
 
-		printf("[ProcGen] %d - sending process with id %d and running time %d and arrivaltime  %d and priority %d\n", getClk(), proc->id, proc->running_time, proc->arrival_time, proc->priority);
+		if (!send_processes(batch, count, schedulerPid)) {
+			return 0;
+		}
+	}
 
-		// send via msgq
-		msgBuffer.data = *proc;
+	return 1;
+}
 
-		if (msgsnd(process_msgq_id, &msgBuffer, sizeof(msgBuffer.data), !IPC_NOWAIT) == -1) {
-			perror("Error in send");
-			return 0;
+/// Hands a batch of processes to the scheduler over the chosen transport with a single wakeup
+int send_processes(process_data* batch, int count, pid_t schedulerPid) {
+	if (transport == PROCESS_TRANSPORT_RING) {
+		int sent = 0;
+		while (sent < count) {
+			sent += process_ring_publish(arrival_ring, batch + sent, count - sent);
+
+			// wake up the scheduler
+			uint64_t one = 1;
+			if (write(arrival_event_fd, &one, sizeof(one)) == -1) {
+				perror("Error in eventfd write");
+				return 0;
+			}
+
+			if (sent < count) {
+				// ring full, let the scheduler drain it
+				usleep(1000);
+			}
 		}
+
+		return 1;
+	}
+
+	// send via msgq, one message per batch
+	process_batch_message_buffer msgBuffer;
+	msgBuffer.type = 1;
+	msgBuffer.count = count;
+	memcpy(msgBuffer.data, batch, sizeof(process_data) * count);
+
+	size_t size = sizeof(msgBuffer.count) + sizeof(process_data) * count;
+	if (msgsnd(process_msgq_id, &msgBuffer, size, !IPC_NOWAIT) == -1) {
+		perror("Error in send");
+		return 0;
 	}
 
+	// wake up the scheduler
+	kill(schedulerPid, SIGNAL_PROCESS_ARRIVAL);
+
 	return 1;
-}
\ No newline at end of file
+}
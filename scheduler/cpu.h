@@ -0,0 +1,241 @@
+#pragma once
+
+#include "headers.h"
+#include "intrusive_list.h"
+#include "pcb.h"
+#include "bucket_queue.h"
+
+#include <strings.h>
+
+// MLFQ levels fit one bitmap word
+#define MLFQ_MAX_LEVELS 32
+
+// one simulated cpu (OS_CPUS), runs one process at a time out of its own ready queue
+typedef struct cpu_state {
+	int id;
+
+	// ready queue of HPF & SRTN
+	pri_queue process_queue;
+
+	// ready queue of HPF with OS_HPF_QUEUE=bucket, one FIFO per priority
+	bucket_queue hpf_buckets;
+
+	// ready queue of RR, pcbs are linked in directly
+	intrusive_list rr_queue;
+
+	// ready queues of MLFQ, one per level, bit i of mlfq_bitmap set = level i isn't empty
+	intrusive_list mlfq_queues[MLFQ_MAX_LEVELS];
+	unsigned int mlfq_bitmap;
+	int mlfq_length;
+
+	// ready queue of CFS ordered by vruntime, min_vruntime only grows and is where newcomers start
+	rb_tree cfs_tree;
+	long long cfs_min_vruntime;
+
+	process_control_block* running_process;
+
+	int last_rr_change_time;
+
+	// ticks spent running something, busy_since is when the current run began (-1 = idle)
+	long long busy_ticks;
+	int busy_since;
+
+	// processes taken from other cpus' queues
+	long steals;
+} cpu_state;
+
+void cpu_state_init(cpu_state* cpu, int id) {
+	if (!cpu) return;
+
+	cpu->id = id;
+
+	pri_queue_init(&cpu->process_queue);
+	bucket_queue_init(&cpu->hpf_buckets);
+	intrusive_list_init(&cpu->rr_queue);
+
+	for (int i = 0; i < MLFQ_MAX_LEVELS; i++) {
+		intrusive_list_init(&cpu->mlfq_queues[i]);
+	}
+
+	cpu->mlfq_bitmap = 0;
+	cpu->mlfq_length = 0;
+
+	rb_tree_init(&cpu->cfs_tree);
+	cpu->cfs_min_vruntime = 0;
+
+	cpu->running_process = 0;
+
+	// initially -1
+	cpu->last_rr_change_time = -1;
+
+	cpu->busy_ticks = 0;
+	cpu->busy_since = -1;
+
+	cpu->steals = 0;
+}
+
+void cpu_state_free(cpu_state* cpu) {
+	if (!cpu) return;
+
+	pri_queue_free(&cpu->process_queue);
+}
+
+/// Ready processes waiting for this cpu, whichever queue the algorithm uses
+int cpu_state_queue_length(cpu_state* cpu) {
+	return cpu->process_queue.count + cpu->hpf_buckets.count + cpu->rr_queue.count + cpu->mlfq_length + cpu->cfs_tree.count;
+}
+
+/// Busy ticks as of now, the current run included
+long long cpu_state_busy_ticks(cpu_state* cpu, int now) {
+	if (cpu->busy_since == -1) return cpu->busy_ticks;
+
+	return cpu->busy_ticks + now - cpu->busy_since;
+}
+
+/// pcb starts running on cpu, an outgoing process that was never released is charged up to now
+void cpu_state_assign(cpu_state* cpu, process_control_block* pcb, int now) {
+	if (cpu->busy_since != -1) {
+		cpu->busy_ticks += now - cpu->busy_since;
+	}
+
+	cpu->running_process = pcb;
+	cpu->busy_since = now;
+
+	pcb->cpu = cpu->id;
+}
+
+/// Whatever ran on cpu stopped (paused or finished), charges its busy time
+void cpu_state_release(cpu_state* cpu, int now) {
+	if (cpu->busy_since != -1) {
+		cpu->busy_ticks += now - cpu->busy_since;
+		cpu->busy_since = -1;
+	}
+
+	cpu->running_process = 0;
+}
+
+// ================================MLFQ================================
+
+/// Queues pcb at the back of its level
+void cpu_state_mlfq_push(cpu_state* cpu, process_control_block* pcb) {
+	intrusive_list_push_back(&cpu->mlfq_queues[pcb->level], &pcb->ready_link);
+
+	cpu->mlfq_bitmap |= 1u << pcb->level;
+	cpu->mlfq_length++;
+}
+
+/// Highest non-empty level, -1 if nothing is queued
+int cpu_state_mlfq_top_level(cpu_state* cpu) {
+	// lowest set bit = highest level
+	return ffs(cpu->mlfq_bitmap) - 1;
+}
+
+process_control_block* cpu_state_mlfq_peek(cpu_state* cpu) {
+	int level = cpu_state_mlfq_top_level(cpu);
+	if (level == -1) return 0;
+
+	intrusive_link* link = intrusive_list_peek_front(&cpu->mlfq_queues[level]);
+	return intrusive_list_entry(link, process_control_block, ready_link);
+}
+
+void cpu_state_mlfq_remove(cpu_state* cpu, process_control_block* pcb) {
+	intrusive_list* queue = &cpu->mlfq_queues[pcb->level];
+	if (!intrusive_list_remove(queue, &pcb->ready_link)) return;
+
+	cpu->mlfq_length--;
+
+	if (queue->count == 0) {
+		cpu->mlfq_bitmap &= ~(1u << pcb->level);
+	}
+}
+
+/// Takes the oldest process of the highest level
+process_control_block* cpu_state_mlfq_pop(cpu_state* cpu) {
+	process_control_block* pcb = cpu_state_mlfq_peek(cpu);
+	if (pcb) {
+		cpu_state_mlfq_remove(cpu, pcb);
+	}
+
+	return pcb;
+}
+
+// ================================CFS================================
+
+// weight of a nice 0 task, a tick of it adds CFS_VRUNTIME_TICK to its vruntime
+#define CFS_NICE_0_WEIGHT 1024
+#define CFS_VRUNTIME_TICK 1024LL
+
+// linux's nice -> weight table, every nice step is ~10% cpu
+const int cfs_nice_weights[40] = {
+	/* -20 */ 88761, 71755, 56483, 46273, 36291,
+	/* -15 */ 29154, 23254, 18705, 14949, 11916,
+	/* -10 */ 9548, 7620, 6100, 4904, 3906,
+	/*  -5 */ 3121, 2501, 1991, 1586, 1277,
+	/*   0 */ 1024, 820, 655, 526, 423,
+	/*   5 */ 335, 272, 215, 172, 137,
+	/*  10 */ 110, 87, 70, 56, 45,
+	/*  15 */ 36, 29, 23, 18, 15,
+};
+
+/// Priority 0 (highest) runs at nice 0, every lower priority one nice step further
+int cfs_weight(int priority) {
+	if (priority < 0) priority = 0;
+	if (priority > 19) priority = 19;
+
+	return cfs_nice_weights[20 + priority];
+}
+
+// vruntime order, equal ones stay FIFO
+int cfs_less(rb_node* a, rb_node* b) {
+	return rb_tree_entry(a, process_control_block, cfs_node)->vruntime < rb_tree_entry(b, process_control_block, cfs_node)->vruntime;
+}
+
+void cpu_state_cfs_push(cpu_state* cpu, process_control_block* pcb) {
+	rb_tree_insert(&cpu->cfs_tree, &pcb->cfs_node, cfs_less);
+}
+
+/// Smallest vruntime, 0 if nothing is queued
+process_control_block* cpu_state_cfs_peek(cpu_state* cpu) {
+	rb_node* first = rb_tree_first(&cpu->cfs_tree);
+	return first ? rb_tree_entry(first, process_control_block, cfs_node) : 0;
+}
+
+void cpu_state_cfs_remove(cpu_state* cpu, process_control_block* pcb) {
+	rb_tree_remove(&cpu->cfs_tree, &pcb->cfs_node);
+}
+
+process_control_block* cpu_state_cfs_pop(cpu_state* cpu) {
+	process_control_block* pcb = cpu_state_cfs_peek(cpu);
+	if (pcb) {
+		cpu_state_cfs_remove(cpu, pcb);
+	}
+
+	return pcb;
+}
+
+/// Charges pcb for the ticks it ran since vruntime_at, lighter tasks age faster
+void cfs_charge(process_control_block* pcb, int now) {
+	int elapsed = now - pcb->vruntime_at;
+	if (elapsed <= 0) return;
+
+	pcb->vruntime += elapsed * CFS_VRUNTIME_TICK * CFS_NICE_0_WEIGHT / pcb->weight;
+	pcb->vruntime_at = now;
+}
+
+/// min_vruntime follows the smallest of the running & queued vruntimes, never backwards
+void cpu_state_cfs_update_min(cpu_state* cpu) {
+	long long min = LLONG_MAX;
+
+	if (cpu->running_process) {
+		min = cpu->running_process->vruntime;
+	}
+
+	process_control_block* first = cpu_state_cfs_peek(cpu);
+	if (first && first->vruntime < min) {
+		min = first->vruntime;
+	}
+
+	if (min != LLONG_MAX && min > cpu->cfs_min_vruntime) {
+		cpu->cfs_min_vruntime = min;
+	}
+}
@@ -1,9 +1,8 @@
 #pragma once
 
-#define PROCESS_STATE_RDY 0
-#define PROCESS_STATE_STARTED 1
-#define PROCESS_STATE_TERMINATED 2
-#define PROCESS_STATE_RESUMED 3
+#include "headers.h"
+#include "intrusive_list.h"
+#include "rb_tree.h"
 
 typedef struct process_control_block {
 	int state;
@@ -11,7 +10,11 @@ typedef struct process_control_block {
 
 	// linux/runtime related
 	struct {
+		// -1 until spawned, 0 if the backend has no os process behind it
 		int proc_pid;
+
+		// waitpid status once reaped, -1 before
+		int exit_status;
 	} system;
 
 	struct {
@@ -27,6 +30,29 @@ typedef struct process_control_block {
 	int remaining_time;
 	int running_time;
 	int arrival_time;
+
+	// cpu whose ready queue holds it / that runs it
+	int cpu;
+
+	// slot in its cpu's process_queue, -1 when not queued
+	int queue_handle;
+
+	// link in FIFO ready queues (RR, MLFQ, HPF buckets), no node allocation needed
+	intrusive_link ready_link;
+
+	// MLFQ level, 0 = highest
+	int level;
+
+	// CFS: node in its cpu's vruntime tree, weight from priority
+	rb_node cfs_node;
+	int weight;
+
+	// CFS: weighted ticks run (scaled, see cfs_charge), charged up to vruntime_at
+	long long vruntime;
+	int vruntime_at;
+
+	// remaining time published by the process itself, 0 if the backend has none
+	process_status* status;
 } process_control_block;
 
 int process_control_block_turnaround_time(process_control_block* pcb) {
@@ -40,19 +66,3 @@ float process_control_block_weighted_turnaround_time(process_control_block* pcb)
 
 	return process_control_block_turnaround_time(pcb) / (float)pcb->running_time;
 }
-
-typedef struct pcb_system_pid_iterator {
-	int system_pid;
-	process_control_block** result;
-} pcb_system_pid_iterator;
-
-void process_table_find_pcb_from_system_iterator(void* value, void* param) {
-	if (!value || !param) return;
-
-	process_control_block* pcb = (process_control_block*)value;
-	pcb_system_pid_iterator* it = (pcb_system_pid_iterator*)param;
-
-	if (it->system_pid == pcb->system.proc_pid) {
-		*it->result = pcb;
-	}
-}
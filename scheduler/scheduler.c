@@ -1,38 +1,261 @@
 #include "headers.h"
 #include "pri_queue.h"
 #include "doubly_linked_list.h"
+#include "hash_map.h"
+#include "pool.h"
+#include "log_writer.h"
+#include "report.h"
+#include "trace.h"
+#include "metrics.h"
 #include "pcb.h"
+#include "cpu.h"
 
-#include <math.h>
+#include <sys/signalfd.h>
+#include <sys/epoll.h>
+#include <sys/timerfd.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <limits.h>
+#include <sched.h>
 
 int initialize_message_queue();
+int initialize_ring(int eventFd);
+int receive_arrivals(int algorithm);
+int admit_processes(process_data* batch, int count, int algorithm);
 int register_process_control_block(process_data* data, int algorithm, /*out*/ process_control_block** pcbEntry);
 int fork_process(process_control_block* pcb);
+pid_t start_process(const char* arg0, const char* arg1);
+void assign_status_slot(process_control_block* pcb);
+int run_event_loop(void(*algorithmHandler)(cpu_state*, int), int quantum, int algorithm, int processesCount);
+int run_simulation(void(*algorithmHandler)(cpu_state*, int), int quantum, int algorithm, int processesCount);
 process_control_block* process_table_find_pcb_from_system(int systemPid);
 
+// ready queue
+int process_queue_key(process_control_block* pcb);
+int aged_priority_key(process_control_block* pcb);
+int running_queue_key(process_control_block* pcb);
+cpu_state* pick_cpu();
+void enqueue_process(process_control_block* pcb);
+void move_buckets_to_heap();
+int dequeue_process(cpu_state* cpu, process_control_block** pcb);
+int peek_process(cpu_state* cpu, process_control_block** pcb);
+void reprioritize_process(process_control_block* pcb);
+void sync_remaining_time(process_control_block* pcb);
+void remove_queued_process(process_control_block* pcb);
+int steal_process(cpu_state* cpu);
+
 // schedule algos
-void sched_hpf();
-void sched_srtn();
-void sched_rr(int);
+void schedule_cpus(void(*algorithmHandler)(cpu_state*, int), int quantum);
+void sched_hpf(cpu_state*, int);
+void sched_srtn(cpu_state*, int);
+void sched_rr(cpu_state*, int);
+void sched_mlfq(cpu_state*, int);
+void sched_cfs(cpu_state*, int);
+int cfs_preempt_tick(cpu_state* cpu);
+int hpf_preempt_tick(cpu_state* cpu);
+int initialize_mlfq(int quantum);
+void boost_mlfq();
+
+// process pool
+int initialize_process_pool(int size);
+int pooled_spawn_process(process_control_block* pcb);
+void process_pool_job_done(int index);
+void process_pool_forget(pid_t pid);
+void destroy_process_pool();
+
+// events
+int initialize_event_loop();
+int wait_for_events();
+void schedule_tick_wakeup(int tick);
 
 // sig handlers
-void process_termination_handler(int);
-void process_running_time_handler(int);
+int reap_processes();
+void terminate_process(process_control_block* pcb);
 
 void log_data(process_control_block*);
-void log_perf();
+void log_perf(int final);
+void poll_perf();
+
+// live metrics (OS_METRICS)
+void roll_metrics_tick();
+void publish_metrics();
+int busy_cpu_count();
 
 key_t process_msgq_id;
 
+// ring transport (see process_ring), arrival_event_fd is -1 on the msgq fallback
+process_ring* arrival_ring;
+int arrival_event_fd = -1;
+
+// max arrivals taken from the ring per consume
+#define ARRIVAL_BATCH_SIZE 64
+
+// signals arrive here instead of interrupting us, see scheduler_event_signals
+int signal_fd;
+int epoll_fd;
+
+// fires when the clock reaches tick_wakeup_target (RR quantum expiry)
+int tick_timer_fd = -1;
+int tick_wakeup_target;
+
+int scheduling_algorithm;
+
+// SIGINT/SIGTERM arrived, leave the event loop and shut down cleanly (logs get flushed)
+bool stop_requested;
+
+// scheduler.log (or scheduler.trace), stays open for the whole run
+log_writer scheduler_log;
+
+// OS_TRACE=1, log binary records to scheduler.trace instead of text (see trace_convert)
+bool binary_trace;
+
+// remaining time of every process, one slot each, see process_status
+process_status* process_status_table;
+int next_status_slot;
+
 // all processes reside here
 doubly_linked_list process_table;
 
+// pcbs and process_table nodes live here for the whole run
+pool pcb_pool;
+pool list_node_pool;
+
+// process_table index, system pid -> pcb (live children only)
+hash_map process_by_system_pid;
+
 int terminated_processes_count;
 
-pri_queue process_queue;
-process_control_block* running_process;
+// OS_CPUS simulated cpus, each with its own ready queue & running process
+cpu_state* cpus;
+int cpu_count;
+
+// MLFQ setup: OS_MLFQ_LEVELS levels, quantum of every level (OS_MLFQ_QUANTA)
+int mlfq_levels;
+int mlfq_quanta[MLFQ_MAX_LEVELS];
+
+// OS_MLFQ_BOOST ticks between moving everything back to the top level, 0 = never
+int mlfq_boost_interval;
+int next_mlfq_boost;
+
+// HPF: preempt the running process for a higher (effective) priority arrival
+bool hpf_preemptive;
+
+// HPF: OS_AGING_INTERVAL ticks of waiting raise the effective priority by one, 0 = no aging
+int aging_interval;
+
+// HPF: OS_HPF_QUEUE=bucket, O(1) bucket_queue instead of process_queue
+bool hpf_bucket_queue;
+
+// CFS: OS_CFS_GRANULARITY nice 0 ticks the running task may lead the queue by before it's preempted
+long long cfs_granularity;
+
+// how processes are created, continued and paused
+typedef struct process_backend {
+	const char* name;
+
+	int (*spawn)(process_control_block*);
+
+	// 0 if the process can't be continued (already gone)
+	int (*resume)(process_control_block*);
+	void (*pause)(process_control_block*);
+
+	// advances the running job by the elapsed ticks when the backend executes jobs itself, 0 otherwise
+	void (*tick)(process_control_block*);
+} process_backend;
+
+// real children driven by SIGCONT/SIGTSTP
+int system_resume_process(process_control_block* pcb);
+void system_pause_process(process_control_block* pcb);
+
+process_backend system_backend = { "system", fork_process, system_resume_process, system_pause_process, 0 };
+
+// nothing runs, the simulation loop consumes remaining time itself
+int simulated_spawn_process(process_control_block* pcb);
+int simulated_resume_process(process_control_block* pcb);
+void simulated_pause_process(process_control_block* pcb);
+
+process_backend simulated_backend = { "simulated", simulated_spawn_process, simulated_resume_process, simulated_pause_process, 0 };
+
+// OS_BACKEND=inline, jobs are records stepped by the scheduler on every tick, no os process at all
+int inline_spawn_process(process_control_block* pcb);
+int inline_resume_process(process_control_block* pcb);
+void inline_pause_process(process_control_block* pcb);
+void inline_tick(process_control_block* pcb);
+
+process_backend inline_backend = { "inline", inline_spawn_process, inline_resume_process, inline_pause_process, inline_tick };
+
+// pre-forked workers take jobs over shared memory, paused/continued like real children
+process_backend pooled_backend = { "pooled", pooled_spawn_process, system_resume_process, system_pause_process, 0 };
+
+process_backend* backend = &system_backend;
+
+// OS_PROCESS_POOL workers, see process_pool_slot
+typedef struct process_pool_worker {
+	pid_t pid;
 
-int last_rr_change_time;
+	// job it's running, 0 when idle
+	process_control_block* pcb;
+
+	bool alive;
+} process_pool_worker;
+
+process_pool_slot* process_pool_slots;
+process_pool_worker* process_pool_workers;
+int process_pool_size;
+
+// stack of idle worker indices
+int* process_pool_idle;
+int process_pool_idle_count;
+
+struct {
+	long long startup_us;
+
+	long jobs;
+
+	// arrivals that found no idle worker and were forked
+	long fallback_forks;
+} process_pool_stats;
+
+// getClk() reads this in simulation mode
+clk_shared simulated_clock;
+
+// processes.txt in arrival order, simulation mode only
+pri_queue pending_arrivals;
+
+// dispatch (context switch) latency, decision to SIGCONT
+struct {
+	long count;
+	long long total_us;
+	long long max_us;
+} context_switch_stats;
+
+// waits for a running process to publish the current tick (sync_remaining_time),
+// a process that wakes us on time keeps these far below a tick
+struct {
+	long count;
+	long timeouts;
+	long long max_us;
+} status_wait_stats;
+
+// WTA/waiting/TA aggregates, updated on every termination
+perf_totals perf_stats;
+
+// OS_PERF_INTERVAL ticks between mid-run scheduler.perf snapshots, 0 = only at exit
+int perf_interval;
+int next_perf_tick;
+
+// OS_METRICS page, 0 = off
+metrics_page* live_metrics;
+
+// what the next publish copies into live_metrics
+metrics_page metrics_snapshot;
+
+// process creation cost, backend->spawn of every arrival
+struct {
+	long count;
+	long long total_us;
+	long long max_us;
+} spawn_stats;
 
 // doubly_linked_list rr_seq;
 
@@ -40,16 +263,14 @@ int last_rr_change_time;
 
 int main(int argc, char** argv) {
 	int algorithm = atoi(argv[1]);
-	int quantum = atoi(argv[2]); // rr quantum only
+	int quantum = atoi(argv[2]); // rr/mlfq quantum, 1 = preemptive hpf
 	int processesCount = atoi(argv[3]); // total num of processes
-
-	// process termination handler
-	signal(SIGUSR1, process_termination_handler);
-	signal(SIGUSR2, process_running_time_handler);
+	int arrivalEventFd = argc > 4 ? atoi(argv[4]) : -1; // ring wakeup, -1 = msgq
+	bool simulate = is_simulation_mode();
 
 	printf("[Scheduler] Starting with algo=%d, q=%d, procCount=%d\n", algorithm, quantum, processesCount);
 
-	if (algorithm < 0 || algorithm > 2) {
+	if (algorithm < 0 || algorithm > SCHEDULING_ALGO_CFS) {
 		perror("Invalid algorithm");
 		exit(EXIT_FAILURE);
 	}
@@ -59,7 +280,51 @@ int main(int argc, char** argv) {
 		exit(EXIT_FAILURE);
 	}
 
-	void(*algorithmHandler)(int) = 0;
+	if (algorithm == SCHEDULING_ALGO_MLFQ && !initialize_mlfq(quantum)) {
+		perror("Invalid MLFQ setup");
+		exit(EXIT_FAILURE);
+	}
+
+	if (algorithm == SCHEDULING_ALGO_HPF) {
+		hpf_preemptive = quantum == 1;
+
+		aging_interval = get_env_option_int("OS_AGING_INTERVAL", 0);
+		if (aging_interval < 0) {
+			perror("Invalid aging interval");
+			exit(EXIT_FAILURE);
+		}
+
+		hpf_bucket_queue = strcmp(get_env_option("OS_HPF_QUEUE", "heap"), "bucket") == 0;
+
+		// aged keys grow with time, they don't fit a bounded number of buckets
+		if (hpf_bucket_queue && aging_interval > 0) {
+			printf("[Scheduler] Aging needs the heap queue, ignoring OS_HPF_QUEUE=bucket\n");
+			hpf_bucket_queue = false;
+		}
+
+		printf("[Scheduler] HPF %s, aging %s, %s queue\n", hpf_preemptive ? "preemptive" : "non-preemptive", aging_interval > 0 ? "on" : "off",
+			hpf_bucket_queue ? "bucket" : "heap");
+	}
+
+	if (algorithm == SCHEDULING_ALGO_CFS) {
+		int granularity = get_env_option_int("OS_CFS_GRANULARITY", 2);
+		if (granularity < 1) {
+			perror("Invalid CFS granularity");
+			exit(EXIT_FAILURE);
+		}
+
+		cfs_granularity = granularity * CFS_VRUNTIME_TICK;
+	}
+
+	scheduling_algorithm = algorithm;
+
+	cpu_count = get_env_option_int("OS_CPUS", 1);
+	if (cpu_count < 1) {
+		perror("Invalid cpu count");
+		exit(EXIT_FAILURE);
+	}
+
+	void(*algorithmHandler)(cpu_state*, int) = 0;
 
 	switch (algorithm) {
 	case SCHEDULING_ALGO_HPF:
@@ -74,6 +339,14 @@ int main(int argc, char** argv) {
 		algorithmHandler = sched_rr;
 		break;
 
+	case SCHEDULING_ALGO_MLFQ:
+		algorithmHandler = sched_mlfq;
+		break;
+
+	case SCHEDULING_ALGO_CFS:
+		algorithmHandler = sched_cfs;
+		break;
+
 	default:
 		// how did we end up here :)?
 		perror("This should never happen lol");
@@ -81,80 +354,132 @@ int main(int argc, char** argv) {
 		break;
 	}
 
-	initClk();
+	if (simulate) {
+		backend = &simulated_backend;
+
+		// we replay the trace ourselves
+		pri_queue_init(&pending_arrivals);
+		if (!read_processes(&pending_arrivals, &processesCount)) {
+			perror("Cannot read processes");
+			exit(EXIT_FAILURE);
+		}
+
+		// no clock process, getClk() reads our own clock
+		simulated_clock.tick = 0;
+		simulated_clock.period_us = 0;
+		shmaddr = &simulated_clock;
+	}
+	else {
+		if (!initialize_event_loop()) {
+			perror("Event loop init failed");
+			exit(EXIT_FAILURE);
+		}
+
+		initClk();
+
+		process_status_table = process_status_attach(processesCount, true);
+		if (!process_status_table) {
+			perror("Status table init failed");
+			exit(EXIT_FAILURE);
+		}
+
+		int poolSize = get_env_option_int("OS_PROCESS_POOL", 0);
+		if (strcmp(get_env_option("OS_BACKEND", "system"), "inline") == 0) {
+			backend = &inline_backend;
+		}
+		else if (poolSize > 0) {
+			if (!initialize_process_pool(poolSize)) {
+				perror("Process pool init failed");
+				exit(EXIT_FAILURE);
+			}
+
+			backend = &pooled_backend;
+		}
+	}
 
-	// delete old log files
+	// delete old log files, a trace run doesn't rewrite scheduler.log
 	remove("scheduler.log");
 	remove("scheduler.perf");
 
-	// init queue & table
-	doubly_linked_list_init(&process_table);
-	pri_queue_init(&process_queue);
+	// flushed when the buffer fills, OS_LOG_FLUSH_MS after the oldest pending line, and at exit
+	long long logFlushUs = get_env_option_int("OS_LOG_FLUSH_MS", LOG_WRITER_DEFAULT_FLUSH_US / 1000) * 1000LL;
+	binary_trace = get_env_option_int("OS_TRACE", 0) != 0;
 
-	// doubly_linked_list_init(&rr_seq);
+	perf_totals_init(&perf_stats);
 
-	if (!initialize_message_queue()) {
-		perror("Msg queue init failed");
-		goto exit;
+	perf_interval = get_env_option_int("OS_PERF_INTERVAL", 0);
+	next_perf_tick = perf_interval;
+
+	// before the metrics page, publishing reads every cpu
+	cpus = (cpu_state*)malloc(sizeof(cpu_state) * cpu_count);
+	if (!cpus) {
+		perror("Cannot allocate cpus");
+		exit(EXIT_FAILURE);
 	}
 
-	// initially 0
-	terminated_processes_count = 0;
+	for (int i = 0; i < cpu_count; i++) {
+		cpu_state_init(&cpus[i], i);
+	}
 
-	// initially -1
-	last_rr_change_time = -1;
+	if (get_env_option_int("OS_METRICS", 0) != 0) {
+		live_metrics = metrics_attach(true);
+		if (!live_metrics) {
+			perror("Metrics page init failed");
+			exit(EXIT_FAILURE);
+		}
 
-	// when do we terminate?
-	// terminatedProcessesCount = processesCount
+		metrics_snapshot.active = 1;
+		metrics_snapshot.algorithm = algorithm;
+		metrics_snapshot.processes_count = processesCount;
+		metrics_snapshot.cpus = cpu_count;
+		metrics_snapshot.running_pid = -1;
 
-	process_message_buffer msgBuffer;
-	while (terminated_processes_count < processesCount) {
-		// check for arrivals
-		int canSkip = 0;
-
-		do {
-			if (msgrcv(process_msgq_id, &msgBuffer, sizeof(msgBuffer.data), 1, IPC_NOWAIT) == -1) {
-				if (errno != ENOMSG) {
-					// something went wrong
-					perror("msgrcv failure");
-					goto exit;
-				}
+		publish_metrics();
+	}
 
-				// we're fine
-				canSkip = 1;
-			}
-			else {
-				// we have a new process
-				// enqueue process!
+	const char* logPath = binary_trace ? "scheduler.trace" : "scheduler.log";
+	if (!log_writer_open(&scheduler_log, logPath, LOG_WRITER_DEFAULT_BUFFER, logFlushUs)) {
+		exit(EXIT_FAILURE);
+	}
 
-				printf("[Scheduler] %d - Received new proc, pid=%d, at=%d, rt=%d\n", getClk(), msgBuffer.data.id, msgBuffer.data.arrival_time, msgBuffer.data.running_time);
+	if (binary_trace) {
+		trace_write_header(&scheduler_log);
+	}
 
-				process_control_block* pcb;
-				if (!register_process_control_block(&msgBuffer.data, algorithm, &pcb)) {
-					// failed
-					perror("Cannot register pcb");
-					goto exit;
-				}
+	// init pools, queue & table
+	pool_init(&pcb_pool, sizeof(process_control_block), processesCount);
+	pool_init(&list_node_pool, sizeof(doubly_linked_list_node), processesCount);
 
-				// schedule algo continues the process
+	doubly_linked_list_init_pool(&process_table, &list_node_pool);
 
-				if (!fork_process(pcb)) {
-					perror("Cannot run process");
-					goto exit;
-				}
-			}
-		} while (canSkip == 0);
+	// sized up front so the termination handler never sees a rehash
+	hash_map_init(&process_by_system_pid, processesCount);
 
-		if (algorithmHandler) {
-			algorithmHandler(quantum);
-		}
-		else {
-			printf("No handler set, so we're doing some work ;)");
-		}
+	// doubly_linked_list_init(&rr_seq);
+
+	// initially 0
+	terminated_processes_count = 0;
+
+	// when do we terminate?
+	// terminatedProcessesCount = processesCount
 
-		usleep(100 * 1000); // polling
+	if (simulate) {
+		run_simulation(algorithmHandler, quantum, algorithm, processesCount);
+		goto exit;
+	}
+
+	if (arrivalEventFd != -1) {
+		if (!initialize_ring(arrivalEventFd)) {
+			perror("Ring init failed");
+			goto exit;
+		}
+	}
+	else if (!initialize_message_queue()) {
+		perror("Msg queue init failed");
+		goto exit;
 	}
 
+	run_event_loop(algorithmHandler, quantum, algorithm, processesCount);
 
 exit:
 
@@ -163,7 +488,13 @@ exit:
 	while (n) {
 		process_control_block* pcb = (process_control_block*)n->value;
 
-		printf("PROCESS\tid=%d\tST=%d\tFT=%d\n", pcb->pid, pcb->stats.start, pcb->stats.finish);
+		printf("PROCESS\tid=%d\tST=%d\tFT=%d\tEXIT=%d\n", pcb->pid, pcb->stats.start, pcb->stats.finish,
+			pcb->system.exit_status != -1 && WIFEXITED(pcb->system.exit_status) ? WEXITSTATUS(pcb->system.exit_status) : -1);
+
+		// interrupted run, a stopped process would outlive us (SIGINT waits for a SIGCONT)
+		if (stop_requested && pcb->state != PROCESS_STATE_TERMINATED && pcb->system.proc_pid > 0 && pcb->system.exit_status == -1) {
+			kill(pcb->system.proc_pid, SIGKILL);
+		}
 
 		n = n->next;
 	}
@@ -177,462 +508,1854 @@ exit:
 		n = n->next;
 	}*/
 
-	// log performance
-	log_perf();
+	// log performance (adds the trace summary too)
+	log_perf(1);
+
+	if (live_metrics) {
+		// readers see the final numbers, then the page goes away with the last of them
+		metrics_snapshot.active = 0;
+		publish_metrics();
+
+		metrics_detach(live_metrics, true);
+	}
+
+	log_writer_close(&scheduler_log);
+	print_log_writer_stats(&scheduler_log, binary_trace ? "scheduler.trace" : "scheduler.log");
 
 	printf("[Scheduler] Exiting...\n");
 
-	// free table & queue
+	if (status_wait_stats.count > 0) {
+		printf("[Scheduler] Status waits: %ld, max=%lld us, timed out=%ld\n", status_wait_stats.count, status_wait_stats.max_us, status_wait_stats.timeouts);
+	}
+
+	if (cpu_count > 1) {
+		long long cpuBusyTicks = 0;
+
+		for (int i = 0; i < cpu_count; i++) {
+			printf("[Scheduler] CPU %d: busy=%lld ticks, steals=%ld\n", i, cpu_state_busy_ticks(&cpus[i], getClk()), cpus[i].steals);
+
+			cpuBusyTicks += cpu_state_busy_ticks(&cpus[i], getClk());
+		}
+
+		// every tick a process ran was spent on exactly one cpu
+		if (cpuBusyTicks != perf_stats.busy_ticks) {
+			printf("[WARNING] CPUs were busy for %lld ticks, processes ran for %lld\n", cpuBusyTicks, perf_stats.busy_ticks);
+		}
+	}
+
+	// free table & queues
 	doubly_linked_list_free(&process_table);
-	pri_queue_free(&process_queue);
+
+	for (int i = 0; i < cpu_count; i++) {
+		cpu_state_free(&cpus[i]);
+	}
+
+	free(cpus);
+
+	hash_map_free(&process_by_system_pid);
+
+	print_pool_stats(&pcb_pool, "pcb");
+	print_pool_stats(&list_node_pool, "process table nodes");
+
+	// releases every pcb & node at once
+	pool_destroy(&pcb_pool);
+	pool_destroy(&list_node_pool);
+
+	if (simulate) {
+		pri_queue_free(&pending_arrivals);
+		return 0;
+	}
+
+	close(epoll_fd);
+	close(signal_fd);
+	close(tick_timer_fd);
+
+	if (arrival_ring) {
+		process_ring_detach(arrival_ring, false);
+		close(arrival_event_fd);
+	}
+
+	destroy_process_pool();
+
+	process_status_detach(process_status_table, true);
 
 	destroyClk(false);
 
 	return 0;
 }
 
-/// Initializes the Gen-Sched msg queue
-int initialize_message_queue() {
-	process_msgq_id = msgget(MSGKEY, 0666 | IPC_CREAT);
-	if (process_msgq_id == -1) {
-		perror("Error in create Message Queue");
-		return 0;
+/// Real-time run: processes come from the generator and run as children
+int run_event_loop(void(*algorithmHandler)(cpu_state*, int), int quantum, int algorithm, int processesCount) {
+	while (terminated_processes_count < processesCount && !stop_requested) {
+		// the running jobs consume the ticks that passed (inline backend), they may finish here
+		if (backend->tick) {
+			for (int i = 0; i < cpu_count; i++) {
+				if (cpus[i].running_process) {
+					backend->tick(cpus[i].running_process);
+				}
+			}
+		}
+
+		// check for arrivals
+		if (!receive_arrivals(algorithm)) {
+			return 0;
+		}
+
+		// pick up the ticks the running processes consumed
+		for (int i = 0; i < cpu_count; i++) {
+			sync_remaining_time(cpus[i].running_process);
+		}
+
+		if (algorithmHandler) {
+			schedule_cpus(algorithmHandler, quantum);
+		}
+		else {
+			printf("No handler set, so we're doing some work ;)");
+		}
+
+		publish_metrics();
+
+		if (terminated_processes_count >= processesCount) {
+			break;
+		}
+
+		// don't let a quiet period hold lines back
+		log_writer_poll(&scheduler_log);
+
+		poll_perf();
+
+		// nothing else steps an inline job, come back on the next tick
+		if (backend->tick) {
+			for (int i = 0; i < cpu_count; i++) {
+				if (cpus[i].running_process) {
+					schedule_tick_wakeup(getClk() + 1);
+					break;
+				}
+			}
+		}
+
+		// sleep until an arrival, termination or quantum expiry
+		if (!wait_for_events()) {
+			perror("Event loop failure");
+			return 0;
+		}
 	}
 
 	return 1;
 }
 
-/// Registers a process in the process table as a PCB
-int register_process_control_block(process_data* data, int algorithm, /*out*/ process_control_block** pcbEntry) {
-	if (!data) {
-		return 0;
-	}
+/// Discrete-event run: same algorithms and logs, but the clock jumps straight
+/// to the next arrival, completion or quantum expiry instead of ticking in real time
+int run_simulation(void(*algorithmHandler)(cpu_state*, int), int quantum, int algorithm, int processesCount) {
+	process_data batch[PROCESS_BATCH_MAX];
 
-	process_control_block* pcb = malloc(sizeof(process_control_block));
+	while (terminated_processes_count < processesCount) {
+		// everything due now arrives as one batch, like the generator sends it
+		int count = 0;
 
-	// initially ready
-	pcb->state = PROCESS_STATE_RDY;
+		process_data* data;
+		while (pri_queue_peek(&pending_arrivals, (void**)&data) && data->arrival_time <= getClk()) {
+			pri_queue_dequeue(&pending_arrivals, 0);
 
-	pcb->pid = data->id;
-	pcb->priority = data->priority;
+			batch[count++] = *data;
+			free(data);
 
-	// initially rem time = running time
-	pcb->remaining_time = data->running_time;
-	pcb->running_time = data->running_time;
+			if (count == PROCESS_BATCH_MAX) {
+				if (!admit_processes(batch, count, algorithm)) return 0;
+				count = 0;
+			}
+		}
 
-	pcb->arrival_time = data->arrival_time;
+		if (count > 0 && !admit_processes(batch, count, algorithm)) {
+			return 0;
+		}
 
-	// not started yet
-	pcb->system.proc_pid = -1;
+		schedule_cpus(algorithmHandler, quantum);
 
-	// initial stats
-	pcb->stats.start = -1;
-	pcb->stats.finish = -1;
+		publish_metrics();
+		poll_perf();
 
-	pcb->stats.waiting_time = 0;
-	pcb->stats.last_finish = -1;
+		if (terminated_processes_count >= processesCount) {
+			break;
+		}
 
-	switch (algorithm) {
-	case SCHEDULING_ALGO_HPF:
-		doubly_linked_list_add(&process_table, pcb);
-		pri_queue_enqueue(&process_queue, pcb->priority, pcb);
-		break;
+		// when does something happen next?
+		int next = INT_MAX;
 
-	case SCHEDULING_ALGO_SRTN:
-		doubly_linked_list_add(&process_table, pcb);
-		pri_queue_enqueue(&process_queue, pcb->remaining_time, pcb);
-		break;
+		if (pri_queue_peek(&pending_arrivals, (void**)&data)) {
+			next = data->arrival_time;
+		}
+
+		int now = getClk();
+
+		for (int i = 0; i < cpu_count; i++) {
+			cpu_state* cpu = &cpus[i];
+			if (!cpu->running_process) continue;
+
+			int finish = now + cpu->running_process->remaining_time;
+			if (finish < next) next = finish;
+
+			if (algorithm == SCHEDULING_ALGO_RR && cpu->last_rr_change_time + quantum < next) {
+				next = cpu->last_rr_change_time + quantum;
+			}
+
+			if (algorithm == SCHEDULING_ALGO_MLFQ && cpu->last_rr_change_time + mlfq_quanta[cpu->running_process->level] < next) {
+				next = cpu->last_rr_change_time + mlfq_quanta[cpu->running_process->level];
+			}
+		}
+
+		if (algorithm == SCHEDULING_ALGO_CFS) {
+			for (int i = 0; i < cpu_count; i++) {
+				int preempt = cfs_preempt_tick(&cpus[i]);
+				if (preempt < next) next = preempt;
+			}
+		}
+
+		if (algorithm == SCHEDULING_ALGO_HPF) {
+			for (int i = 0; i < cpu_count; i++) {
+				int preempt = hpf_preempt_tick(&cpus[i]);
+				if (preempt < next) next = preempt;
+			}
+		}
+
+		if (algorithm == SCHEDULING_ALGO_MLFQ && mlfq_boost_interval > 0 && next_mlfq_boost < next) {
+			next = next_mlfq_boost;
+		}
+
+		if (next == INT_MAX) {
+			printf("[Scheduler] Simulation stalled at %d\n", now);
+			return 0;
+		}
+
+		// always make progress
+		if (next <= now) {
+			next = now + 1;
+		}
+
+		// the running processes used up the skipped ticks
+		for (int i = 0; i < cpu_count; i++) {
+			if (cpus[i].running_process) {
+				cpus[i].running_process->remaining_time -= next - now;
+			}
+		}
+
+		simulated_clock.tick = next;
+
+		for (int i = 0; i < cpu_count; i++) {
+			process_control_block* pcb = cpus[i].running_process;
+
+			if (pcb && pcb->remaining_time <= 0) {
+				pcb->remaining_time = 0;
+				terminate_process(pcb);
+			}
+		}
+	}
+
+	return 1;
+}
+
+// ================================Events================================
+
+/// Routes the scheduler's signals to a signalfd watched by epoll
+int initialize_event_loop() {
+	sigset_t eventSignals;
+	scheduler_event_signals(&eventSignals);
+
+	// already blocked by the generator, but don't rely on it
+	if (sigprocmask(SIG_BLOCK, &eventSignals, NULL) == -1) {
+		perror("Cannot block event signals");
+		return 0;
+	}
+
+	signal_fd = signalfd(-1, &eventSignals, SFD_NONBLOCK | SFD_CLOEXEC);
+	if (signal_fd == -1) {
+		perror("Cannot create signalfd");
+		return 0;
+	}
+
+	epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+	if (epoll_fd == -1) {
+		perror("Cannot create epoll");
+		return 0;
+	}
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = signal_fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, signal_fd, &ev) == -1) {
+		perror("Cannot watch signalfd");
+		return 0;
+	}
+
+	tick_timer_fd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	if (tick_timer_fd == -1) {
+		perror("Cannot create tick timerfd");
+		return 0;
+	}
+
+	ev.events = EPOLLIN;
+	ev.data.fd = tick_timer_fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, tick_timer_fd, &ev) == -1) {
+		perror("Cannot watch tick timerfd");
+		return 0;
+	}
+
+	return 1;
+}
+
+/// Wakes the event loop once the clock reaches tick, unless an earlier wakeup is still pending
+void schedule_tick_wakeup(int tick) {
+	// no timer in simulation mode
+	if (tick_timer_fd == -1) return;
+
+	// another cpu needs us sooner, every round asks again anyway
+	if (tick_wakeup_target > getClk() && tick_wakeup_target <= tick) return;
+
+	tick_wakeup_target = tick;
+
+	// the clock publishes tick n at epoch + n * period
+	long long at = getClkTickTimeUs(tick);
+
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+	spec.it_value.tv_sec = at / 1000000;
+	spec.it_value.tv_nsec = (at % 1000000) * 1000;
+
+	if (timerfd_settime(tick_timer_fd, TFD_TIMER_ABSTIME, &spec, NULL) == -1) {
+		perror("Cannot arm tick timerfd");
+	}
+}
+
+/// Blocks until at least one event is ready (or the log is due for a flush), then handles every pending one
+int wait_for_events() {
+	struct epoll_event events[4];
+
+	// pending log lines bound the sleep, the main loop flushes them when they're due
+	int timeoutMs = log_writer_poll_timeout_ms(&scheduler_log);
+
+	int ready;
+	do {
+		ready = epoll_wait(epoll_fd, events, 4, timeoutMs);
+	} while (ready == -1 && errno == EINTR);
+
+	if (ready == -1) {
+		return 0;
+	}
+
+	for (int i = 0; i < ready; i++) {
+		if (events[i].data.fd == arrival_event_fd) {
+			// reset the counter, the main loop drains the ring
+			uint64_t published;
+			read(arrival_event_fd, &published, sizeof(published));
+		}
+		else if (events[i].data.fd == tick_timer_fd) {
+			uint64_t expirations;
+			read(tick_timer_fd, &expirations, sizeof(expirations));
+
+			// the timer can beat the clock process by a few us, wait for the tick itself
+			waitForTick(tick_wakeup_target);
+		}
+	}
+
+	struct signalfd_siginfo info;
+	while (read(signal_fd, &info, sizeof(info)) == sizeof(info)) {
+		int sig = info.ssi_signo;
+
+		if (sig == SIGCHLD) {
+			// one SIGCHLD may stand for many exits, reap them all
+			reap_processes();
+		}
+		else if (sig == SIGINT || sig == SIGTERM) {
+			printf("[Scheduler] Interrupted, shutting down\n");
+			stop_requested = true;
+		}
+		else if (sig == SIGNAL_PROCESS_DONE) {
+			// real-time, one per finished job
+			process_pool_job_done(info.ssi_int);
+		}
+
+		// arrivals only need to wake us up,
+		// the main loop drains the transport every round
+	}
+
+	return 1;
+}
+
+/// Initializes the Gen-Sched msg queue
+int initialize_message_queue() {
+	process_msgq_id = msgget(MSGKEY, 0666 | IPC_CREAT);
+	if (process_msgq_id == -1) {
+		perror("Error in create Message Queue");
+		return 0;
+	}
+
+	return 1;
+}
+
+/// Attaches the generator's arrival ring, eventFd is inherited from the generator
+int initialize_ring(int eventFd) {
+	arrival_ring = process_ring_attach(false);
+	if (!arrival_ring) {
+		return 0;
+	}
+
+	arrival_event_fd = eventFd;
+
+	// don't leak it into our processes
+	fcntl(arrival_event_fd, F_SETFD, FD_CLOEXEC);
+
+	struct epoll_event ev;
+	ev.events = EPOLLIN;
+	ev.data.fd = arrival_event_fd;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, arrival_event_fd, &ev) == -1) {
+		perror("Cannot watch arrival eventfd");
+		return 0;
+	}
+
+	return 1;
+}
+
+/// Drains every pending arrival from the transport
+int receive_arrivals(int algorithm) {
+	if (arrival_ring) {
+		process_data batch[ARRIVAL_BATCH_SIZE];
+
+		int count;
+		while ((count = process_ring_consume(arrival_ring, batch, ARRIVAL_BATCH_SIZE)) > 0) {
+			if (!admit_processes(batch, count, algorithm)) {
+				return 0;
+			}
+		}
+
+		return 1;
+	}
+
+	process_batch_message_buffer msgBuffer;
+	while (1) {
+		size_t maxSize = sizeof(msgBuffer) - sizeof(msgBuffer.type);
+		if (msgrcv(process_msgq_id, &msgBuffer, maxSize, 1, IPC_NOWAIT) == -1) {
+			if (errno != ENOMSG) {
+				// something went wrong
+				perror("msgrcv failure");
+				return 0;
+			}
+
+			// we're fine
+			return 1;
+		}
+
+		if (!admit_processes(msgBuffer.data, msgBuffer.count, algorithm)) {
+			return 0;
+		}
+	}
+}
+
+/// Registers a batch of newly arrived processes in one pass, then forks them
+int admit_processes(process_data* batch, int count, int algorithm) {
+	process_control_block* pcbs[PROCESS_BATCH_MAX];
+
+	// ring batches can't be bigger than ARRIVAL_BATCH_SIZE, msgs than PROCESS_BATCH_MAX
+	for (int i = 0; i < count; i++) {
+		// we have a new process
+		// enqueue process!
+
+		printf("[Scheduler] %d - Received new proc, pid=%d, at=%d, rt=%d\n", getClk(), batch[i].id, batch[i].arrival_time, batch[i].running_time);
+
+		if (!register_process_control_block(&batch[i], algorithm, &pcbs[i])) {
+			// failed
+			perror("Cannot register pcb");
+			return 0;
+		}
+	}
+
+	// schedule algo continues the process
+
+	for (int i = 0; i < count; i++) {
+		long long spawnStart = monotonic_time_us();
+
+		if (!backend->spawn(pcbs[i])) {
+			perror("Cannot run process");
+			return 0;
+		}
+
+		long long cost = monotonic_time_us() - spawnStart;
+
+		spawn_stats.count++;
+		spawn_stats.total_us += cost;
+		if (cost > spawn_stats.max_us) {
+			spawn_stats.max_us = cost;
+		}
+	}
+
+	if (live_metrics) {
+		roll_metrics_tick();
+
+		metrics_snapshot.arrivals += count;
+		metrics_snapshot.tick_arrivals += count;
+	}
+
+	return 1;
+}
+
+/// Registers a process in the process table as a PCB
+int register_process_control_block(process_data* data, int algorithm, /*out*/ process_control_block** pcbEntry) {
+	if (!data) {
+		return 0;
+	}
+
+	process_control_block* pcb = (process_control_block*)pool_alloc(&pcb_pool);
+	if (!pcb) {
+		return 0;
+	}
+
+	// initially ready
+	pcb->state = PROCESS_STATE_RDY;
+
+	pcb->pid = data->id;
+	pcb->priority = data->priority;
+
+	// initially rem time = running time
+	pcb->remaining_time = data->running_time;
+	pcb->running_time = data->running_time;
+
+	pcb->arrival_time = data->arrival_time;
+
+	// not started yet
+	pcb->system.proc_pid = -1;
+	pcb->system.exit_status = -1;
+
+	// initial stats
+	pcb->stats.start = -1;
+	pcb->stats.finish = -1;
+
+	pcb->stats.waiting_time = 0;
+	pcb->stats.last_finish = -1;
+
+	// not queued yet
+	pcb->queue_handle = -1;
+	intrusive_link_init(&pcb->ready_link);
+
+	// everyone starts at the top
+	pcb->level = 0;
+
+	// its queue from now on, until another cpu steals it
+	pcb->cpu = pick_cpu()->id;
+
+	// newcomers start level with the least served task, they can't monopolize the cpu
+	rb_node_init(&pcb->cfs_node);
+	pcb->weight = cfs_weight(pcb->priority);
+	pcb->vruntime = cpus[pcb->cpu].cfs_min_vruntime;
+	pcb->vruntime_at = -1;
+
+	switch (algorithm) {
+	case SCHEDULING_ALGO_HPF:
+	case SCHEDULING_ALGO_SRTN:
+	case SCHEDULING_ALGO_RR:
+	case SCHEDULING_ALGO_MLFQ:
+	case SCHEDULING_ALGO_CFS:
+		if (!doubly_linked_list_add(&process_table, pcb)) {
+			// table node pool exhausted
+			pool_free(&pcb_pool, pcb);
+			return 0;
+		}
+
+
+		if (binary_trace) {
+			trace_write_process(&scheduler_log, pcb->pid, pcb->arrival_time, pcb->running_time, pcb->priority);
+		}
+
+		enqueue_process(pcb);
+		break;
+
+	default:
+		perror("Unknown algorithm");
+
+		pool_free(&pcb_pool, pcb);
+		return 0;
+	}
+
+	if (pcbEntry) {
+		*pcbEntry = pcb;
+	}
+
+	return 1;
+}
+
+/// Forks a new process from pcb
+int fork_process(process_control_block* pcb) {
+	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid != -1) {
+		// dont fork process
+		return 0;
+	}
+
+	// alloc params
+	char params[2][10];
+	sprintf(params[0], "%d", pcb->remaining_time);
+	sprintf(params[1], "%d", next_status_slot);
+
+	pid_t child = start_process(params[0], params[1]);
+	if (child == -1) {
+		return 0;
+	}
+
+	assign_status_slot(pcb);
+
+	// assign system pid
+	pcb->system.proc_pid = child;
+	hash_map_put(&process_by_system_pid, child, pcb);
+
+	return 1;
+}
+
+/// Forks & execs process.out with two args, returns the child pid or -1
+pid_t start_process(const char* arg0, const char* arg1) {
+	// fork
+	pid_t child = fork();
+	if (child == -1) {
+		perror("Failed to fork process");
+		return -1;
+	}
+	else if (child == 0) {
+		// our event signals are blocked, the process shouldn't inherit that
+		sigset_t eventSignals;
+		scheduler_event_signals(&eventSignals);
+		sigprocmask(SIG_UNBLOCK, &eventSignals, NULL);
+
+		execl("./process.out", "process.out", arg0, arg1, NULL);
+
+		perror("Cannot exec process.out");
+		exit(-1);
+	}
+
+	return child;
+}
+
+/// Gives pcb the next status slot, the process writes its remaining time there from now on
+void assign_status_slot(process_control_block* pcb) {
+	pcb->status = &process_status_table[next_status_slot++];
+	pcb->status->remaining_time = pcb->remaining_time;
+	pcb->status->updated_at = -1;
+}
+
+process_control_block* process_table_find_pcb_from_system(int systemPid) {
+	return (process_control_block*)hash_map_get(&process_by_system_pid, systemPid);
+}
+
+/// Waits until the process is actually stopped so a SIGCONT can't get lost
+/// Returns 0 if it exited instead (reaped later by the termination path)
+int wait_process_stopped(process_control_block* pcb) {
+	siginfo_t info;
+
+	while (1) {
+		// peek without consuming, an exit must stay waitable for the termination handler
+		info.si_pid = 0;
+		if (waitid(P_PID, pcb->system.proc_pid, &info, WSTOPPED | WEXITED | WNOWAIT) == -1) {
+			if (errno == EINTR) continue;
+
+			perror("waitid failure");
+			return 0;
+		}
+
+		if (info.si_code != CLD_STOPPED && info.si_code != CLD_TRAPPED) {
+			// exited/killed
+			return 0;
+		}
+
+		// consume the stop notification
+		waitid(P_PID, pcb->system.proc_pid, &info, WSTOPPED | WNOHANG);
+		return 1;
+	}
+}
+
+// ================================Ready queue================================
+
+/// Lazy aging: effective priority = priority - waited / interval. Every queued pcb ages at the same pace,
+/// so priority * interval + the tick it became ready orders them like their effective priorities at any
+/// moment, the key is fixed at enqueue and nothing is ever rescanned
+int aged_priority_key(process_control_block* pcb) {
+	int readySince = pcb->stats.last_finish != -1 ? pcb->stats.last_finish : pcb->arrival_time;
+
+	return pcb->priority * aging_interval + readySince;
+}
+
+/// Key the running pcb is compared with for preemption, it doesn't age while it has the cpu
+/// so it's keyed as if it became ready just now
+int running_queue_key(process_control_block* pcb) {
+	if (scheduling_algorithm == SCHEDULING_ALGO_HPF && aging_interval > 0) {
+		return pcb->priority * aging_interval + getClk();
+	}
+
+	return process_queue_key(pcb);
+}
+
+/// Ordering key of a pcb in process_queue for the current algorithm
+int process_queue_key(process_control_block* pcb) {
+	switch (scheduling_algorithm) {
+	case SCHEDULING_ALGO_HPF:
+		return aging_interval > 0 ? aged_priority_key(pcb) : pcb->priority;
+
+	case SCHEDULING_ALGO_SRTN:
+		return pcb->remaining_time;
+
+	default:
+		// RR, insert at end of queue
+		return 0;
+	}
+}
+
+/// Least loaded cpu (queued + running), arrivals are spread with it
+cpu_state* pick_cpu() {
+	cpu_state* best = &cpus[0];
+	int bestLoad = INT_MAX;
+
+	for (int i = 0; i < cpu_count; i++) {
+		int load = cpu_state_queue_length(&cpus[i]) + (cpus[i].running_process ? 1 : 0);
+
+		if (load < bestLoad) {
+			best = &cpus[i];
+			bestLoad = load;
+		}
+	}
+
+	return best;
+}
+
+/// Turns OS_HPF_QUEUE=bucket off for the rest of the run, queued pcbs keep their order
+void move_buckets_to_heap() {
+	hpf_bucket_queue = false;
+
+	for (int i = 0; i < cpu_count; i++) {
+		intrusive_link* link;
+
+		// lowest priority first & FIFO within one, the heap's sequence keeps ties in that order
+		while ((link = bucket_queue_pop(&cpus[i].hpf_buckets))) {
+			enqueue_process(intrusive_list_entry(link, process_control_block, ready_link));
+		}
+	}
+}
+
+/// Queues pcb on its cpu
+void enqueue_process(process_control_block* pcb) {
+	if (!pcb) return;
+
+	cpu_state* cpu = &cpus[pcb->cpu];
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_RR) {
+		intrusive_list_push_back(&cpu->rr_queue, &pcb->ready_link);
+		return;
+	}
+
+	if (hpf_bucket_queue && !bucket_queue_fits(process_queue_key(pcb))) {
+		// the buckets would merge it with others, the heap orders any priority
+		printf("[Scheduler] Priority %d of pid=%d doesn't fit the bucket queue, switching to the heap\n", pcb->priority, pcb->pid);
+
+		move_buckets_to_heap();
+	}
+
+	if (hpf_bucket_queue) {
+		if (!intrusive_link_is_linked(&pcb->ready_link)) {
+			bucket_queue_push(&cpu->hpf_buckets, process_queue_key(pcb), &pcb->ready_link);
+		}
+
+		return;
+	}
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_MLFQ) {
+		cpu_state_mlfq_push(cpu, pcb);
+		return;
+	}
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_CFS) {
+		if (!rb_node_is_linked(&pcb->cfs_node)) {
+			cpu_state_cfs_push(cpu, pcb);
+		}
+
+		return;
+	}
+
+	if (pcb->queue_handle != -1) return;
+
+	pri_queue_enqueue_handle(&cpu->process_queue, process_queue_key(pcb), pcb, &pcb->queue_handle);
+}
+
+int dequeue_process(cpu_state* cpu, process_control_block** pcb) {
+	if (scheduling_algorithm == SCHEDULING_ALGO_MLFQ || scheduling_algorithm == SCHEDULING_ALGO_CFS) {
+		process_control_block* top = scheduling_algorithm == SCHEDULING_ALGO_MLFQ ? cpu_state_mlfq_pop(cpu) : cpu_state_cfs_pop(cpu);
+		if (!top) return 0;
+
+		if (pcb) {
+			*pcb = top;
+		}
+
+		return 1;
+	}
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_RR || hpf_bucket_queue) {
+		intrusive_link* link = hpf_bucket_queue ? bucket_queue_pop(&cpu->hpf_buckets) : intrusive_list_pop_front(&cpu->rr_queue);
+		if (!link) return 0;
+
+		if (pcb) {
+			*pcb = intrusive_list_entry(link, process_control_block, ready_link);
+		}
+
+		return 1;
+	}
+
+	return pri_queue_dequeue(&cpu->process_queue, (void**)pcb);
+}
+
+int peek_process(cpu_state* cpu, process_control_block** pcb) {
+	if (!pcb) return 0;
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_MLFQ) {
+		*pcb = cpu_state_mlfq_peek(cpu);
+		return *pcb != 0;
+	}
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_CFS) {
+		*pcb = cpu_state_cfs_peek(cpu);
+		return *pcb != 0;
+	}
+
+	if (scheduling_algorithm == SCHEDULING_ALGO_RR || hpf_bucket_queue) {
+		intrusive_link* link = hpf_bucket_queue ? bucket_queue_peek(&cpu->hpf_buckets) : intrusive_list_peek_front(&cpu->rr_queue);
+		if (!link) return 0;
+
+		*pcb = intrusive_list_entry(link, process_control_block, ready_link);
+		return 1;
+	}
+
+	return pri_queue_peek(&cpu->process_queue, (void**)pcb);
+}
+
+/// Re-sorts a queued pcb after its key changed (remaining time correction, priority boost)
+void reprioritize_process(process_control_block* pcb) {
+	// FIFO queues have no key
+	if (!pcb || pcb->queue_handle == -1) return;
+
+	pri_queue_update(&cpus[pcb->cpu].process_queue, pcb->queue_handle, process_queue_key(pcb));
+}
+
+/// Copies the remaining time the process published into its pcb
+void sync_remaining_time(process_control_block* pcb) {
+	if (!pcb || !pcb->status) return;
+
+	int remaining = __atomic_load_n(&pcb->status->remaining_time, __ATOMIC_ACQUIRE);
+
+	// the running process wakes on the same tick we do, give it a moment to account for it
+	// (only when an os process runs it, inline jobs are stepped by us)
+	if (pcb == cpus[pcb->cpu].running_process && pcb->system.proc_pid > 0 && (pcb->state == PROCESS_STATE_STARTED || pcb->state == PROCESS_STATE_RESUMED)) {
+		long long waitStart = monotonic_time_us();
+		long long deadline = waitStart + getClkPeriodUs() / 4;
+		int now = getClk();
+		int waited = 0;
+
+		while (remaining > 0) {
+			// read the word before checking the time, an update in between makes FUTEX_WAIT return at once
+			int seen = __atomic_load_n(&pcb->status->updated_at, __ATOMIC_ACQUIRE);
+			if (seen >= now) {
+				remaining = __atomic_load_n(&pcb->status->remaining_time, __ATOMIC_ACQUIRE);
+				break;
+			}
+
+			long long left = deadline - monotonic_time_us();
+			if (left <= 0) {
+				printf("[Scheduler] pid=%d didn't publish tick %d in time\n", pcb->pid, now);
+
+				status_wait_stats.timeouts++;
+				break;
+			}
+
+			waited = 1;
+
+			// the process wakes updated_at after publishing, sleep on it instead of spinning
+			struct timespec timeout = { left / 1000000, (left % 1000000) * 1000 };
+			syscall(SYS_futex, &pcb->status->updated_at, FUTEX_WAIT, seen, &timeout, NULL, 0);
+		}
+
+		if (waited) {
+			long long waitUs = monotonic_time_us() - waitStart;
+
+			status_wait_stats.count++;
+			if (waitUs > status_wait_stats.max_us) {
+				status_wait_stats.max_us = waitUs;
+			}
+		}
+	}
+	if (remaining == pcb->remaining_time) return;
+
+	pcb->remaining_time = remaining;
+
+	// RR re-queues the running process before pausing it, keep its slot in order
+	reprioritize_process(pcb);
+}
+
+/// Takes a pcb out of the ready queue wherever it is
+void remove_queued_process(process_control_block* pcb) {
+	if (!pcb) return;
+
+	if (rb_node_is_linked(&pcb->cfs_node)) {
+		cpu_state_cfs_remove(&cpus[pcb->cpu], pcb);
+		return;
+	}
+
+	if (intrusive_link_is_linked(&pcb->ready_link)) {
+		if (scheduling_algorithm == SCHEDULING_ALGO_MLFQ) {
+			cpu_state_mlfq_remove(&cpus[pcb->cpu], pcb);
+		}
+		else if (hpf_bucket_queue) {
+			bucket_queue_remove(&cpus[pcb->cpu].hpf_buckets, &pcb->ready_link);
+		}
+		else {
+			intrusive_list_remove(&cpus[pcb->cpu].rr_queue, &pcb->ready_link);
+		}
+
+		return;
+	}
+
+	if (pcb->queue_handle == -1) return;
+
+	pri_queue_remove(&cpus[pcb->cpu].process_queue, pcb->queue_handle, 0);
+}
+
+/// An idle cpu with nothing queued takes the next process of the longest queue
+int steal_process(cpu_state* cpu) {
+	cpu_state* victim = 0;
+	int victimLength = 0;
+
+	for (int i = 0; i < cpu_count; i++) {
+		if (&cpus[i] == cpu) continue;
+
+		int length = cpu_state_queue_length(&cpus[i]);
+		if (length > victimLength) {
+			victim = &cpus[i];
+			victimLength = length;
+		}
+	}
+
+	process_control_block* pcb;
+	if (!victim || !dequeue_process(victim, &pcb)) return 0;
+
+	printf("CPU %d stole process id=%d from CPU %d\n", cpu->id, pcb->pid, victim->id);
+
+	// vruntimes only compare within a cpu, keep its lead over the old cpu's minimum
+	pcb->vruntime += cpu->cfs_min_vruntime - victim->cfs_min_vruntime;
+
+	pcb->cpu = cpu->id;
+	enqueue_process(pcb);
+
+	cpu->steals++;
+	return 1;
+}
+
+void run_process(cpu_state* cpu, process_control_block* pcb) {
+	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid == -1) {
+		// dont run process
+		return;
+	}
+
+	long long dispatchStart = monotonic_time_us();
+
+	cpu_state_assign(cpu, pcb, getClk());
+
+	printf("Setting pid=%d sysPid=%d running on cpu %d\n", pcb->pid, pcb->system.proc_pid, cpu->id);
+
+	// change state
+	pcb->state = PROCESS_STATE_RESUMED;
+
+	// set start time
+	if (pcb->stats.start == -1) {
+		pcb->stats.start = getClk();
+
+		pcb->state = PROCESS_STATE_STARTED;
+
+		// were we waiting?
+		pcb->stats.waiting_time += pcb->stats.start - pcb->arrival_time;
+	}
+	else {
+		// update waiting
+		pcb->stats.waiting_time += getClk() - pcb->stats.last_finish;
+	}
+
+	log_data(pcb);
+
+	//int* xxz = malloc(4); *xxz = pcb->pid;
+	//doubly_linked_list_add(&rr_seq, xxz);
+
+	if (!backend->resume(pcb)) {
+		// finished meanwhile, termination will follow
+		return;
+	}
+
+	long long latency = monotonic_time_us() - dispatchStart;
+
+	context_switch_stats.count++;
+	context_switch_stats.total_us += latency;
+	if (latency > context_switch_stats.max_us) {
+		context_switch_stats.max_us = latency;
+	}
+
+	metrics_snapshot.dispatch_latency[metrics_latency_bucket(latency)]++;
+}
+
+void pause_process(process_control_block* pcb) {
+	if (!pcb || (pcb->state != PROCESS_STATE_STARTED && pcb->state != PROCESS_STATE_RESUMED) || pcb->system.proc_pid == -1) {
+		// dont pause process
+		return;
+	}
+
+	// the process may have used up its time since the last sync
+	sync_remaining_time(pcb);
+
+	cpu_state* cpu = &cpus[pcb->cpu];
+
+	// keep this here for now
+	if (pcb != cpu->running_process) {
+		printf("[WARNING] PAUSING PROCESS OTHER THAN RUNNING\n");
+	}
+
+	// are we trying to pause a to be killed process?
+	if (pcb->remaining_time > 0) {
+		printf("Setting pid=%d sysPid=%d paused\n", pcb->pid, pcb->system.proc_pid);
+
+		// change state
+		pcb->state = PROCESS_STATE_RDY;
+		pcb->stats.last_finish = getClk();
+
+		log_data(pcb);
+
+		backend->pause(pcb);
+	}
+
+	cpu_state_release(cpu, getClk());
+}
+
+// ================================Process backends================================
+
+int system_resume_process(process_control_block* pcb) {
+	// every dispatch follows exactly one stop (initial raise or our SIGTSTP),
+	// continuing before it lands would be discarded by the kernel
+	if (!wait_process_stopped(pcb)) {
+		return 0;
+	}
+
+	// send cont signal
+	kill(pcb->system.proc_pid, SIGCONT);
+	return 1;
+}
+
+void system_pause_process(process_control_block* pcb) {
+	// send pause signal
+	kill(pcb->system.proc_pid, SIGTSTP);
+}
+
+int simulated_spawn_process(process_control_block* pcb) {
+	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid != -1) {
+		return 0;
+	}
+
+	// no os process behind it
+	pcb->system.proc_pid = 0;
+	return 1;
+}
+
+int simulated_resume_process(process_control_block* pcb) {
+	return 1;
+}
+
+void simulated_pause_process(process_control_block* pcb) {
+}
+
+int inline_spawn_process(process_control_block* pcb) {
+	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid != -1) {
+		return 0;
+	}
+
+	// the job lives in its status slot, same record a process would publish to
+	assign_status_slot(pcb);
+
+	// no os process behind it
+	pcb->system.proc_pid = 0;
+	return 1;
+}
+
+int inline_resume_process(process_control_block* pcb) {
+	// like process.c on SIGCONT, the current tick isn't the job's to count
+	pcb->status->updated_at = getClk();
+	return 1;
+}
+
+void inline_pause_process(process_control_block* pcb) {
+	// nothing runs between ticks, there's nothing to stop
+}
+
+/// Charges the running job for every tick since it last ran, terminates it once done
+void inline_tick(process_control_block* pcb) {
+	process_status* status = pcb->status;
+	if (!status) return;
+
+	int now = getClk();
+	int elapsed = now - status->updated_at;
+	if (elapsed <= 0) return;
+
+	status->remaining_time -= elapsed < status->remaining_time ? elapsed : status->remaining_time;
+	status->updated_at = now;
+
+	if (status->remaining_time == 0) {
+		pcb->system.exit_status = 0;
+		terminate_process(pcb);
+	}
+}
 
-	case SCHEDULING_ALGO_RR:
-		doubly_linked_list_add(&process_table, pcb);
+// ================================Process pool================================
 
-		// insert at end of queue
-		pri_queue_enqueue(&process_queue, 0, pcb);
-		break;
+/// Pre-forks size workers (process.out -w) and waits until all of them are attached
+int initialize_process_pool(int size) {
+	long long startupStart = monotonic_time_us();
 
-	default:
-		perror("Unknown algorithm");
+	process_pool_slots = process_pool_attach(size, true);
+	if (!process_pool_slots) {
+		return 0;
+	}
 
-		free(pcb);
+	process_pool_workers = (process_pool_worker*)malloc(sizeof(process_pool_worker) * size);
+	process_pool_idle = (int*)malloc(sizeof(int) * size);
+	if (!process_pool_workers || !process_pool_idle) {
 		return 0;
 	}
 
-	if (pcbEntry) {
-		*pcbEntry = pcb;
+	process_pool_size = size;
+	process_pool_idle_count = 0;
+
+	for (int i = 0; i < size; i++) {
+		char param[12];
+		sprintf(param, "%d", i);
+
+		process_pool_workers[i].pid = start_process("-w", param);
+		process_pool_workers[i].pcb = 0;
+		process_pool_workers[i].alive = process_pool_workers[i].pid != -1;
+
+		if (!process_pool_workers[i].alive) {
+			return 0;
+		}
+	}
+
+	// a job posted before the worker read job_seq would be missed
+	for (int i = size - 1; i >= 0; i--) {
+		while (!__atomic_load_n(&process_pool_slots[i].ready, __ATOMIC_ACQUIRE)) {
+			usleep(100);
+		}
+
+		process_pool_idle[process_pool_idle_count++] = i;
 	}
 
+	process_pool_stats.startup_us = monotonic_time_us() - startupStart;
+
+	printf("[Scheduler] Process pool of %d workers ready in %lld us\n", size, process_pool_stats.startup_us);
+
 	return 1;
 }
 
-/// Forks a new process from pcb
-int fork_process(process_control_block* pcb) {
+/// Hands pcb to an idle worker, forks a fresh process if every worker is busy
+int pooled_spawn_process(process_control_block* pcb) {
 	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid != -1) {
-		// dont fork process
-		return 0;
-	}
-
-	// fork
-	pid_t child = fork();
-	if (child == -1) {
-		perror("Failed to fork process");
 		return 0;
 	}
-	else if (child == 0) {
-		// alloc params
-		char param[10];
-		sprintf(param, "%d", pcb->remaining_time);
 
-		execl("./process.out", "process.out", param, NULL);
+	if (process_pool_idle_count == 0) {
+		process_pool_stats.fallback_forks++;
+		return fork_process(pcb);
 	}
 
-	// assign system pid
-	pcb->system.proc_pid = child;
+	int index = process_pool_idle[--process_pool_idle_count];
+	process_pool_worker* worker = &process_pool_workers[index];
+	process_pool_slot* slot = &process_pool_slots[index];
 
-	return 1;
-}
+	int statusSlot = next_status_slot;
+	assign_status_slot(pcb);
 
-process_control_block* process_table_find_pcb_from_system(int systemPid) {
-	process_control_block* pcb = 0;
+	worker->pcb = pcb;
 
-	pcb_system_pid_iterator it;
-	it.system_pid = systemPid;
-	it.result = &pcb;
+	pcb->system.proc_pid = worker->pid;
+	hash_map_put(&process_by_system_pid, worker->pid, pcb);
 
-	doubly_linked_list_iterate(&process_table, process_table_find_pcb_from_system_iterator, (void*)&it);
+	// publish the job, the worker stops itself like a new process once it took it
+	slot->remaining_time = pcb->remaining_time;
+	slot->status_slot = statusSlot;
+	__atomic_add_fetch(&slot->job_seq, 1, __ATOMIC_RELEASE);
+	syscall(SYS_futex, &slot->job_seq, FUTEX_WAKE, 1, NULL, NULL, 0);
 
-	return pcb;
+	process_pool_stats.jobs++;
+	return 1;
 }
 
-void run_process(process_control_block* pcb) {
-	if (!pcb || pcb->state != PROCESS_STATE_RDY || pcb->system.proc_pid == -1) {
-		// dont run process
-		return;
-	}
+/// A worker finished its job (SIGNAL_PROCESS_DONE), terminate the job & recycle the worker
+void process_pool_job_done(int index) {
+	if (index < 0 || index >= process_pool_size) return;
 
-	running_process = pcb;
+	process_pool_worker* worker = &process_pool_workers[index];
 
-	printf("Setting pid=%d sysPid=%d running\n", pcb->pid, pcb->system.proc_pid);
+	process_control_block* pcb = worker->pcb;
+	if (!pcb) return;
 
-	// change state
-	pcb->state = PROCESS_STATE_RESUMED;
+	worker->pcb = 0;
 
-	// set start time
-	if (pcb->stats.start == -1) {
-		pcb->stats.start = getClk();
+	printf("Worker %d (pid=%d) finished process id=%d\n", index, worker->pid, pcb->pid);
 
-		pcb->state = PROCESS_STATE_STARTED;
+	// the job ended normally, the worker itself lives on
+	pcb->system.exit_status = 0;
+	terminate_process(pcb);
 
-		// were we waiting?
-		pcb->stats.waiting_time += pcb->stats.start - pcb->arrival_time;
-	}
-	else {
-		// update waiting
-		pcb->stats.waiting_time += getClk() - pcb->stats.last_finish;
-	}
+	process_pool_idle[process_pool_idle_count++] = index;
+}
 
-	log_data(pcb);
+/// A reaped child was a worker, never hand it jobs again
+void process_pool_forget(pid_t pid) {
+	for (int i = 0; i < process_pool_size; i++) {
+		process_pool_worker* worker = &process_pool_workers[i];
+		if (worker->pid != pid || !worker->alive) continue;
 
-	//int* xxz = malloc(4); *xxz = pcb->pid;
-	//doubly_linked_list_add(&rr_seq, xxz);
+		printf("[WARNING] Pool worker %d (pid=%d) died\n", i, pid);
 
-	// sleep for 200ms
-	usleep(200 * 1000);
+		worker->alive = false;
 
-	// send cont signal
-	kill(pcb->system.proc_pid, SIGCONT);
-}
+		// drop it from the idle stack
+		for (int j = 0; j < process_pool_idle_count; j++) {
+			if (process_pool_idle[j] == i) {
+				process_pool_idle[j] = process_pool_idle[--process_pool_idle_count];
+				break;
+			}
+		}
 
-void pause_process(process_control_block* pcb) {
-	if (!pcb || (pcb->state != PROCESS_STATE_STARTED && pcb->state != PROCESS_STATE_RESUMED) || pcb->system.proc_pid == -1) {
-		// dont pause process
+		// its job (if any) is terminated by the reaper through process_by_system_pid
+		worker->pcb = 0;
 		return;
 	}
+}
 
-	// keep this here for now
-	if (pcb != running_process) {
-		printf("[WARNING] PAUSING PROCESS OTHER THAN RUNNING\n");
-	}
+/// Tells every worker to exit and reaps them
+void destroy_process_pool() {
+	if (!process_pool_slots) return;
 
-	// are we trying to pause a to be killed process?
-	if (pcb->remaining_time > 0) {
-		printf("Setting pid=%d sysPid=%d paused\n", pcb->pid, pcb->system.proc_pid);
+	for (int i = 0; i < process_pool_size; i++) {
+		process_pool_slot* slot = &process_pool_slots[i];
 
-		// change state
-		pcb->state = PROCESS_STATE_RDY;
-		pcb->stats.last_finish = getClk();
+		// still busy (interrupted run), it may be stopped and would never see the shutdown
+		if (process_pool_workers[i].alive && process_pool_workers[i].pcb) {
+			kill(process_pool_workers[i].pid, SIGKILL);
+		}
 
-		log_data(pcb);
+		slot->shutdown = 1;
+		__atomic_add_fetch(&slot->job_seq, 1, __ATOMIC_RELEASE);
+		syscall(SYS_futex, &slot->job_seq, FUTEX_WAKE, 1, NULL, NULL, 0);
+	}
 
-		// send pause signal
-		kill(pcb->system.proc_pid, SIGTSTP);
+	for (int i = 0; i < process_pool_size; i++) {
+		if (process_pool_workers[i].alive) {
+			waitpid(process_pool_workers[i].pid, 0, 0);
+		}
 	}
 
-	running_process = 0;
+	printf("[Scheduler] Process pool: %ld jobs, %ld forks avoided, %ld fallback forks\n",
+		process_pool_stats.jobs + process_pool_stats.fallback_forks, process_pool_stats.jobs, process_pool_stats.fallback_forks);
+
+	process_pool_detach(process_pool_slots, true);
+	process_pool_slots = 0;
+
+	free(process_pool_workers);
+	free(process_pool_idle);
 }
 
 // ================================Scheduling algorithms================================
 
-/// HPF scheduler
-void sched_hpf() {
+/// One round on every cpu, an idle cpu with an empty queue steals work first
+void schedule_cpus(void(*algorithmHandler)(cpu_state*, int), int quantum) {
+	for (int i = 0; i < cpu_count; i++) {
+		cpu_state* cpu = &cpus[i];
+
+		// used up its time, the cpu is only free once it's reaped (the termination is on its way)
+		if (cpu->running_process && cpu->running_process->remaining_time == 0) continue;
+
+		if (!cpu->running_process && cpu_state_queue_length(cpu) == 0) {
+			steal_process(cpu);
+		}
+
+		algorithmHandler(cpu, quantum);
+	}
+}
+
+/// Tick at which the queue's head ages past the running process (preemptive HPF with aging), INT_MAX if never
+int hpf_preempt_tick(cpu_state* cpu) {
+	if (!hpf_preemptive || aging_interval <= 0) return INT_MAX;
+
+	process_control_block* running = cpu->running_process;
+	process_control_block* first;
+	if (!running || !peek_process(cpu, &first)) return INT_MAX;
+
+	// the head's key is fixed, the running key grows by one every tick: it has to get past the head's
+	int tick = process_queue_key(first) - running->priority * aging_interval + 1;
+
+	// already past it, the next round preempts
+	return tick > getClk() ? tick : getClk() + 1;
+}
+
+/// HPF scheduler, non-preemptive unless asked for
+void sched_hpf(cpu_state* cpu, int quantum) {
 	// do we have a running process?
-	if (!running_process) {
+	if (!cpu->running_process) {
 		// nothing running
 		// pick highest priority (lowest val)
 
 		process_control_block* pcb;
-		if (pri_queue_dequeue(&process_queue, &pcb)) {
+		if (dequeue_process(cpu, &pcb)) {
 			printf("HPF assigning new proc\n");
 
-			run_process(pcb);
+			run_process(cpu, pcb);
 		}
 	}
 
-	// uncomment for pre-emption
-	/*else {
+	else if (hpf_preemptive) {
 		// we're running, but the queue may have a higher priority
+		process_control_block* running = cpu->running_process;
 		process_control_block* potentialPcb;
-		if (pri_queue_peek(&process_queue, &potentialPcb) && potentialPcb->priority < running_process->priority) {
+		// with aging the one it preempted is ahead again right away, it keeps the cpu for at least the tick it got it
+		// (several rounds can run in one tick, simulation only runs one)
+		bool settled = aging_interval <= 0 || cpu->busy_since < getClk();
+
+		if (running->remaining_time > 0 && settled && peek_process(cpu, &potentialPcb) && process_queue_key(potentialPcb) < running_queue_key(running)) {
 			// the other process has a higher priority
 
 			printf("HPF Found process with higher priority\n");
 
 			// dequeue
-			pri_queue_dequeue(&process_queue, 0);
+			dequeue_process(cpu, 0);
 
-			// re-queue running
-			pri_queue_enqueue(&process_queue, running_process->priority, running_process);
+			// pause running proc first, its wait (and aging) starts now
+			pause_process(running);
 
-			// pause running proc
-			pause_process(running_process);
+			// re-queue running
+			if (running->state == PROCESS_STATE_RDY) {
+				enqueue_process(running);
+			}
 
 			// run new one
-			run_process(potentialPcb);
+			run_process(cpu, potentialPcb);
 		}
-	}*/
+
+		// aging alone can make the head win, nothing else may happen until then
+		int preempt = hpf_preempt_tick(cpu);
+		if (preempt != INT_MAX) {
+			schedule_tick_wakeup(preempt);
+		}
+	}
 }
 
 /// SRTN scheduler
-void sched_srtn() {
+void sched_srtn(cpu_state* cpu, int quantum) {
 	// do we have a running process?
-	if (!running_process) {
+	if (!cpu->running_process) {
 		// nothing running
 		// pick shortest time
 
 		process_control_block* pcb;
-		if (pri_queue_dequeue(&process_queue, &pcb)) {
+		if (dequeue_process(cpu, &pcb)) {
 			printf("SRTN assigning new proc\n");
 
-			run_process(pcb);
+			run_process(cpu, pcb);
 		}
 	}
 	else {
 		// we're running, but the queue may have a lower time
 		process_control_block* potentialPcb;
-		if (pri_queue_peek(&process_queue, &potentialPcb) && potentialPcb->remaining_time < running_process->remaining_time) {
+		if (peek_process(cpu, &potentialPcb) && potentialPcb->remaining_time < cpu->running_process->remaining_time) {
 			// the other process has a lower time
 
 			printf("SRTN Found process with lower time\n");
 
 			// dequeue
-			pri_queue_dequeue(&process_queue, 0);
+			dequeue_process(cpu, 0);
 
 			// re-queue running
-			pri_queue_enqueue(&process_queue, running_process->remaining_time, running_process);
+			enqueue_process(cpu->running_process);
 
 			// pause running proc
-			pause_process(running_process);
+			pause_process(cpu->running_process);
 
 			// run new one
-			run_process(potentialPcb);
+			run_process(cpu, potentialPcb);
 		}
 	}
 }
 
 /// RR scheduler
-void sched_rr(int quantum) {
+void sched_rr(cpu_state* cpu, int quantum) {
 	// do we have a running process?
-	if (!running_process) {
+	if (!cpu->running_process) {
 		// nothing running
 		// pick first in queue
 
 		process_control_block* pcb;
-		if (pri_queue_dequeue(&process_queue, &pcb)) {
+		if (dequeue_process(cpu, &pcb)) {
 			printf("RR assigning new proc\n");
 
 			// update change time
-			last_rr_change_time = getClk();
+			cpu->last_rr_change_time = getClk();
 
-			run_process(pcb);
+			run_process(cpu, pcb);
 		}
 	}
 	else {
 		int now = getClk();
-		if (now - last_rr_change_time >= quantum) {
-			printf("RR quantum change delta=%d\n", now - last_rr_change_time);
+		if (now - cpu->last_rr_change_time >= quantum) {
+			printf("RR quantum change delta=%d\n", now - cpu->last_rr_change_time);
 
-			last_rr_change_time = now;
+			cpu->last_rr_change_time = now;
 
 			// dequeue
 			process_control_block* potentialPcb;
-			if (pri_queue_dequeue(&process_queue, &potentialPcb)) {
+			if (dequeue_process(cpu, &potentialPcb)) {
 				printf("RR Changing process\n");
 
-				if (running_process->remaining_time > 0) {
+				if (cpu->running_process->remaining_time > 0) {
 					// re-queue running
-					pri_queue_enqueue(&process_queue, 0, running_process);
+					enqueue_process(cpu->running_process);
 				}
 
-				//printf("Queue: [ ");
-				//struct pri_queue_node* n = process_queue.head;
-				//while (n)
-				//{
-				//	printf("%d ", ((process_control_block*)n->value)->pid);
-				//	//*(int *)n->value
-				//	n = n->next;
-				//}
-
-				//printf("]\n");
-
-				if (running_process->remaining_time > 0) {
+				if (cpu->running_process->remaining_time > 0) {
 					// pause running proc
-					pause_process(running_process);
+					pause_process(cpu->running_process);
 				}
 
 				// run new one
-				run_process(potentialPcb);
+				run_process(cpu, potentialPcb);
 			}
 		}
 	}
+
+	// wake up on quantum expiry even if nothing else happens
+	if (cpu->running_process) {
+		schedule_tick_wakeup(cpu->last_rr_change_time + quantum);
+	}
 }
 
-/// Called when a process terminates
-void process_termination_handler(int sig) {
-	pid_t pid = wait(0);
+/// Reads the MLFQ options, quantum is the top level's
+int initialize_mlfq(int quantum) {
+	if (quantum < 1) return 0;
 
-	printf("Process with pid=%d just terminated\n", pid);
+	mlfq_levels = get_env_option_int("OS_MLFQ_LEVELS", 3);
+	if (mlfq_levels < 1 || mlfq_levels > MLFQ_MAX_LEVELS) return 0;
 
-	// find pcb
-	process_control_block* pcb = process_table_find_pcb_from_system(pid);
-	if (!pcb) {
-		// how?
-		perror("Cannot find pcb for termination");
+	// every level doubles the one above it, unless OS_MLFQ_QUANTA lists them (e.g. "2,4,8")
+	const char* quanta = get_env_option("OS_MLFQ_QUANTA", "");
 
-		// exit for now
-		exit(-1);
+	for (int i = 0; i < mlfq_levels; i++) {
+		mlfq_quanta[i] = i == 0 ? quantum : mlfq_quanta[i - 1] * 2;
+
+		if (*quanta) {
+			char* end;
+			int value = (int)strtol(quanta, &end, 10);
+			if (end == quanta || value < 1) return 0;
+
+			mlfq_quanta[i] = value;
+
+			quanta = *end == ',' ? end + 1 : end;
+		}
+	}
+
+	mlfq_boost_interval = get_env_option_int("OS_MLFQ_BOOST", 100);
+	next_mlfq_boost = mlfq_boost_interval;
+
+	printf("[Scheduler] MLFQ with %d levels, boost every %d ticks, quanta:", mlfq_levels, mlfq_boost_interval);
+	for (int i = 0; i < mlfq_levels; i++) {
+		printf(" %d", mlfq_quanta[i]);
+	}
+	printf("\n");
+
+	return 1;
+}
+
+/// Moves every process back to the top level so long jobs can't starve
+void boost_mlfq() {
+	printf("MLFQ priority boost\n");
+
+	for (int i = 0; i < cpu_count; i++) {
+		cpu_state* cpu = &cpus[i];
+
+		// oldest first, so they keep their order behind the top level
+		for (int level = 1; level < mlfq_levels; level++) {
+			intrusive_link* link;
+			while ((link = intrusive_list_peek_front(&cpu->mlfq_queues[level]))) {
+				process_control_block* pcb = intrusive_list_entry(link, process_control_block, ready_link);
+
+				cpu_state_mlfq_remove(cpu, pcb);
+
+				pcb->level = 0;
+				cpu_state_mlfq_push(cpu, pcb);
+			}
+		}
+
+		if (cpu->running_process) {
+			cpu->running_process->level = 0;
+		}
+	}
+}
+
+/// MLFQ scheduler
+void sched_mlfq(cpu_state* cpu, int quantum) {
+	int now = getClk();
+
+	// first cpu of the round to see the boost tick does it for everyone
+	if (mlfq_boost_interval > 0 && now >= next_mlfq_boost) {
+		boost_mlfq();
+
+		next_mlfq_boost = now + mlfq_boost_interval;
+	}
+
+	// do we have a running process?
+	if (!cpu->running_process) {
+		// nothing running
+		// pick the oldest process of the highest level
+
+		process_control_block* pcb;
+		if (dequeue_process(cpu, &pcb)) {
+			printf("MLFQ assigning new proc from level %d\n", pcb->level);
+
+			// update change time
+			cpu->last_rr_change_time = now;
+
+			run_process(cpu, pcb);
+		}
+	}
+	else {
+		process_control_block* running = cpu->running_process;
+		process_control_block* potentialPcb;
+
+		if (now - cpu->last_rr_change_time >= mlfq_quanta[running->level]) {
+			// used its whole slice, it's no interactive job
+			if (running->level < mlfq_levels - 1) {
+				running->level++;
+
+				printf("MLFQ demoting process id=%d to level %d\n", running->pid, running->level);
+			}
+
+			cpu->last_rr_change_time = now;
+
+			if (running->remaining_time > 0 && peek_process(cpu, &potentialPcb) && potentialPcb->level <= running->level) {
+				printf("MLFQ Changing process\n");
+
+				dequeue_process(cpu, 0);
+
+				// re-queue running at its new level
+				enqueue_process(running);
+				pause_process(running);
+
+				run_process(cpu, potentialPcb);
+			}
+		}
+		else if (running->remaining_time > 0 && peek_process(cpu, &potentialPcb) && potentialPcb->level < running->level) {
+			// a higher level has work (new arrival or boost)
+			printf("MLFQ Found process on a higher level\n");
+
+			dequeue_process(cpu, 0);
+
+			cpu->last_rr_change_time = now;
+
+			enqueue_process(running);
+			pause_process(running);
+
+			run_process(cpu, potentialPcb);
+		}
+	}
+
+	// wake up on quantum expiry & boosts even if nothing else happens
+	if (cpu->running_process) {
+		schedule_tick_wakeup(cpu->last_rr_change_time + mlfq_quanta[cpu->running_process->level]);
+
+		if (mlfq_boost_interval > 0 && cpu->mlfq_length > 0) {
+			schedule_tick_wakeup(next_mlfq_boost);
+		}
+	}
+}
+
+/// Tick at which the running task's vruntime leads the queue's smallest by the granularity (after now), INT_MAX if nothing waits
+int cfs_preempt_tick(cpu_state* cpu) {
+	process_control_block* running = cpu->running_process;
+	process_control_block* first = cpu_state_cfs_peek(cpu);
+	if (!running || !first) return INT_MAX;
+
+	// already due (e.g. the running task is waiting to be reaped), the next round preempts,
+	// a tick in the past would just keep re-arming the wakeup
+	int now = getClk();
+
+	long long lead = cfs_granularity - (running->vruntime - first->vruntime);
+	if (lead <= 0) return now + 1;
+
+	// vruntime per tick of running, round up so the lead is reached
+	long long perTick = CFS_VRUNTIME_TICK * CFS_NICE_0_WEIGHT / running->weight;
+	long long ticks = (lead + perTick - 1) / perTick;
+
+	if (ticks > INT_MAX - running->vruntime_at) return INT_MAX;
+
+	int tick = running->vruntime_at + (int)ticks;
+	return tick > now ? tick : now + 1;
+}
+
+/// CFS scheduler
+void sched_cfs(cpu_state* cpu, int quantum) {
+	int now = getClk();
+
+	if (cpu->running_process) {
+		cfs_charge(cpu->running_process, now);
+	}
+
+	cpu_state_cfs_update_min(cpu);
+
+	// do we have a running process?
+	if (!cpu->running_process) {
+		// nothing running
+		// pick the smallest vruntime
+
+		process_control_block* pcb;
+		if (dequeue_process(cpu, &pcb)) {
+			printf("CFS assigning new proc vruntime=%lld\n", pcb->vruntime);
+
+			pcb->vruntime_at = now;
+
+			run_process(cpu, pcb);
+		}
+	}
+	else {
+		// we're running, but someone may have fallen too far behind
+		process_control_block* running = cpu->running_process;
+		process_control_block* potentialPcb;
+
+		if (running->remaining_time > 0 && peek_process(cpu, &potentialPcb) && running->vruntime - potentialPcb->vruntime >= cfs_granularity) {
+			printf("CFS Found process with smaller vruntime\n");
+
+			dequeue_process(cpu, 0);
+
+			// re-queue running
+			enqueue_process(running);
+			pause_process(running);
+
+			potentialPcb->vruntime_at = now;
+
+			run_process(cpu, potentialPcb);
+		}
+	}
+
+	// wake up once the running task used up its lead
+	int preempt = cfs_preempt_tick(cpu);
+	if (preempt != INT_MAX) {
+		schedule_tick_wakeup(preempt);
+	}
+}
+
+/// Reaps every exited child without blocking, returns how many were terminated
+int reap_processes() {
+	int reaped = 0;
+
+	while (1) {
+		int status;
+		pid_t pid = waitpid(-1, &status, WNOHANG);
+		if (pid == -1 && errno == EINTR) continue;
+
+		// 0 = children left but none exited, -1 = no children at all
+		if (pid <= 0) break;
+
+		printf("Process with pid=%d just terminated\n", pid);
+
+		process_pool_forget(pid);
+
+		// find pcb
+		process_control_block* pcb = process_table_find_pcb_from_system(pid);
+		if (!pcb) {
+			// not one of our processes
+			printf("[WARNING] Reaped unknown child pid=%d\n", pid);
+			continue;
+		}
+
+		pcb->system.exit_status = status;
+
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+			printf("[WARNING] Process id=%d exited abnormally (status=0x%x)\n", pcb->pid, status);
+		}
+
+		terminate_process(pcb);
+		reaped++;
 	}
 
+	return reaped;
+}
+
+/// Bookkeeping once a process is done, whatever backend ran it
+void terminate_process(process_control_block* pcb) {
 	// set state to terminated
 	pcb->state = PROCESS_STATE_TERMINATED;
+
+	// pid may be reused by the os from now on
+	hash_map_remove(&process_by_system_pid, pcb->system.proc_pid);
 	pcb->system.proc_pid = -1;
 
+	// a finished process must never be picked again
+	remove_queued_process(pcb);
+
+	// last decrement the process published before exiting
+	sync_remaining_time(pcb);
+	pcb->status = 0;
+
 	// set finish time
 	pcb->stats.finish = getClk();
 
 	log_data(pcb);
 
-	if (running_process == pcb) {
-		running_process = 0;
+	perf_totals_add(&perf_stats, process_control_block_turnaround_time(pcb), pcb->stats.waiting_time, pcb->running_time);
+
+	cpu_state* cpu = &cpus[pcb->cpu];
+	if (cpu->running_process == pcb) {
+		cpu_state_release(cpu, pcb->stats.finish);
 	}
 
 	terminated_processes_count++;
+
+	if (live_metrics) {
+		roll_metrics_tick();
+
+		metrics_snapshot.terminations++;
+		metrics_snapshot.tick_terminations++;
+
+		metrics_snapshot.busy_cpus = busy_cpu_count();
+	}
 }
 
-void process_running_time_handler(int sig) {
-	printf("Running process updating remaining time!\n");
+void log_data(process_control_block* pcb) {
+	if (!pcb) return;
 
-	if (!running_process) {
-		printf("[WARNING] Received decrement signal with no running process?\n");
+	// events are only ever handled from the main loop (signalfd), so no signal-safety concerns here
+	if (binary_trace) {
+		trace_write_event(&scheduler_log, getClk(), pcb->pid, pcb->state, pcb->remaining_time, pcb->stats.waiting_time);
 		return;
 	}
 
-	printf("RPID=%d rt=%d\n", running_process->pid, running_process->remaining_time);
-
-	// decrement locally
-	running_process->remaining_time--;
+	report_log_event(&scheduler_log, getClk(), pcb->pid, pcb->state, pcb->arrival_time, pcb->running_time, pcb->remaining_time, pcb->stats.waiting_time);
 }
 
-void log_data(process_control_block* pcb) {
-	if (!pcb) return;
+/// final also closes the trace, mid-run snapshots only rewrite scheduler.perf
+void log_perf(int final) {
+	perf_report report;
+	memset(&report, 0, sizeof(report));
 
-	FILE* f = fopen("scheduler.log", "a");
+	// aggregates are kept up to date by terminate_process, nothing to walk
+	perf_totals_report(&perf_stats, getClk(), cpu_count, &report);
 
-	char* state;
-	switch (pcb->state) {
-	case PROCESS_STATE_RDY:
-		state = "stopped";
-		break;
+	report.context_switches = context_switch_stats.count;
+	report.context_switch_total_us = context_switch_stats.total_us;
+	report.context_switch_max_us = context_switch_stats.max_us;
 
-	case PROCESS_STATE_STARTED:
-		state = "started";
-		break;
+	report.creations = spawn_stats.count;
+	report.creation_total_us = spawn_stats.total_us;
+	report.creation_max_us = spawn_stats.max_us;
 
-	case PROCESS_STATE_RESUMED:
-		state = "resumed";
-		break;
+	report.pool_workers = process_pool_size;
+	report.pool_startup_us = process_pool_stats.startup_us;
 
-	case PROCESS_STATE_TERMINATED:
-		state = "finished";
-		break;
+	float* cpuUtilization = (float*)malloc(sizeof(float) * cpu_count);
+	if (cpuUtilization) {
+		for (int i = 0; i < cpu_count; i++) {
+			cpuUtilization[i] = getClk() > 0 ? cpu_state_busy_ticks(&cpus[i], getClk()) / (float)getClk() : 0.f;
+		}
 
-	default:
-		state = "";
-		break;
+		report.cpu_count = cpu_count;
+		report.cpu_utilization = cpuUtilization;
 	}
 
-	fprintf(f, "At time %d\tprocess %d\t%s   arr %d   total %d   remain %d   wait %d",
-		getClk(), pcb->pid, state, pcb->arrival_time, pcb->running_time, pcb->remaining_time, pcb->stats.waiting_time);
+	if (!final) {
+		// finished processes alone miss whatever is running right now, the cpus count it
+		// (at exit both agree, and trace_convert can only rebuild the processes' side)
+		long long busyTicks = 0;
+		for (int i = 0; i < cpu_count; i++) {
+			busyTicks += cpu_state_busy_ticks(&cpus[i], getClk());
+		}
 
-	if (pcb->state == PROCESS_STATE_TERMINATED) {
-		fprintf(f, "   TA %d   WTA %.2f", process_control_block_turnaround_time(pcb), process_control_block_weighted_turnaround_time(pcb));
+		report.utilization = getClk() > 0 ? busyTicks / ((float)getClk() * cpu_count) : 0.f;
 	}
 
-	fprintf(f, "\n");
-	fclose(f);
+	report_write_perf("scheduler.perf", &report);
+	free(cpuUtilization);
+
+	if (final && binary_trace) {
+		// what trace_convert can't rebuild from the events
+		trace_write_counter(&scheduler_log, TRACE_COUNTER_CONTEXT_SWITCH, context_switch_stats.count, context_switch_stats.total_us, context_switch_stats.max_us);
+		trace_write_counter(&scheduler_log, TRACE_COUNTER_PROCESS_CREATION, spawn_stats.count, spawn_stats.total_us, spawn_stats.max_us);
+
+		if (process_pool_size > 0) {
+			trace_write_counter(&scheduler_log, TRACE_COUNTER_PROCESS_POOL, process_pool_size, process_pool_stats.startup_us, 0);
+		}
+
+		for (int i = 0; i < cpu_count; i++) {
+			trace_write_counter(&scheduler_log, TRACE_COUNTER_CPU, i, cpu_state_busy_ticks(&cpus[i], getClk()), cpu_count);
+		}
+
+		trace_write_end(&scheduler_log, getClk());
+	}
 }
 
-void log_perf() {
-	int totalTime = 0;
-	float totalWTA = 0.f;
-	int totalWaiting = 0;
+/// Rewrites scheduler.perf every OS_PERF_INTERVAL ticks so long runs can be watched
+void poll_perf() {
+	if (perf_interval <= 0 || getClk() < next_perf_tick) return;
 
-	int count = 0;
+	log_perf(0);
 
-	doubly_linked_list_node* n = process_table.head;
-	while (n) {
-		process_control_block* pcb = (process_control_block*)n->value;
+	next_perf_tick = getClk() + perf_interval;
+}
 
-		totalTime += pcb->running_time;
-		totalWTA += process_control_block_weighted_turnaround_time(pcb);
-		totalWaiting += pcb->stats.waiting_time;
+// ================================Live metrics================================
 
-		count++;
+/// Starts a new per-tick window once the clock moved, charging the ticks in between to whoever ran
+void roll_metrics_tick() {
+	int now = getClk();
+	if (now == metrics_snapshot.tick) return;
 
-		n = n->next;
-	}
+	metrics_snapshot.busy_ticks += (long long)(now - metrics_snapshot.tick) * metrics_snapshot.busy_cpus;
 
-	float utilization = totalTime / (float)getClk();
-	float avgWTA = totalWTA / (float)count;
-	float avgWaiting = totalWaiting / (float)count;
+	metrics_snapshot.tick = now;
+	metrics_snapshot.tick_arrivals = 0;
+	metrics_snapshot.tick_terminations = 0;
+}
 
-	// calc std wta
+/// Refreshes the gauges and copies the snapshot to the shared page, once per loop iteration
+void publish_metrics() {
+	if (!live_metrics) return;
 
-	float stdWTA = 0.f;
+	roll_metrics_tick();
 
-	if (count > 0) {
-		doubly_linked_list_node* n = process_table.head;
-		while (n) {
-			process_control_block* pcb = (process_control_block*)n->value;
+	metrics_snapshot.ready_queue_length = 0;
+	metrics_snapshot.running_pid = -1;
 
-			stdWTA += powf(process_control_block_weighted_turnaround_time(pcb) - avgWTA, 2);
+	for (int i = cpu_count - 1; i >= 0; i--) {
+		metrics_snapshot.ready_queue_length += cpu_state_queue_length(&cpus[i]);
 
-			n = n->next;
+		if (cpus[i].running_process) {
+			metrics_snapshot.running_pid = cpus[i].running_process->pid;
 		}
-
-		stdWTA = sqrtf(stdWTA / count);
 	}
 
-	FILE* f = fopen("scheduler.perf", "w");
-	fprintf(f, "CPU Utilization = %.2f%%\nAvg WTA = %.2f\nAvg Waiting = %.2f\nStd WTA = %.2f\n", utilization * 100.f, avgWTA, avgWaiting, stdWTA);
+	metrics_snapshot.busy_cpus = busy_cpu_count();
+	metrics_snapshot.context_switches = context_switch_stats.count;
+	metrics_snapshot.utilization = metrics_snapshot.tick > 0 ? metrics_snapshot.busy_ticks / ((float)metrics_snapshot.tick * cpu_count) : 0.f;
+
+	metrics_publish(live_metrics, &metrics_snapshot);
+}
+
+int busy_cpu_count() {
+	int busy = 0;
+
+	for (int i = 0; i < cpu_count; i++) {
+		if (cpus[i].running_process) busy++;
+	}
 
-	fclose(f);
-}
\ No newline at end of file
+	return busy;
+}
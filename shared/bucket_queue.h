@@ -0,0 +1,100 @@
+#pragma once
+
+#include "intrusive_list.h"
+
+// priorities 0..63, check bucket_queue_fits first, anything outside would be clamped to the nearest bucket
+#define BUCKET_QUEUE_BUCKETS 64
+
+// O(1) priority queue for small bounded priorities: one FIFO per priority,
+// bit i of bitmap set = bucket i isn't empty, the lowest set bit is the head
+typedef struct bucket_queue
+{
+	intrusive_list buckets[BUCKET_QUEUE_BUCKETS];
+	unsigned long long bitmap;
+
+	int count;
+} bucket_queue;
+
+void bucket_queue_init(bucket_queue* q)
+{
+	if (!q)
+		return;
+
+	for (int i = 0; i < BUCKET_QUEUE_BUCKETS; i++)
+	{
+		intrusive_list_init(&q->buckets[i]);
+	}
+
+	q->bitmap = 0;
+	q->count = 0;
+}
+
+/// Whether priority has a bucket of its own
+int bucket_queue_fits(int priority)
+{
+	return priority >= 0 && priority < BUCKET_QUEUE_BUCKETS;
+}
+
+int bucket_queue_bucket(int priority)
+{
+	if (priority < 0)
+		return 0;
+
+	if (priority >= BUCKET_QUEUE_BUCKETS)
+		return BUCKET_QUEUE_BUCKETS - 1;
+
+	return priority;
+}
+
+/// Appends link behind everything of the same priority
+void bucket_queue_push(bucket_queue* q, int priority, intrusive_link* link)
+{
+	int bucket = bucket_queue_bucket(priority);
+
+	intrusive_list_push_back(&q->buckets[bucket], link);
+
+	q->bitmap |= 1ULL << bucket;
+	q->count++;
+}
+
+/// Oldest link of the lowest priority, 0 if empty
+intrusive_link* bucket_queue_peek(bucket_queue* q)
+{
+	if (!q || !q->bitmap)
+		return 0;
+
+	return intrusive_list_peek_front(&q->buckets[__builtin_ctzll(q->bitmap)]);
+}
+
+/// Unlinks link wherever it is in q
+int bucket_queue_remove(bucket_queue* q, intrusive_link* link)
+{
+	if (!q || !link || !link->owner)
+		return 0;
+
+	// the list it's in tells the bucket
+	int bucket = (int)(link->owner - q->buckets);
+	if (bucket < 0 || bucket >= BUCKET_QUEUE_BUCKETS)
+		return 0;
+
+	intrusive_list_remove(&q->buckets[bucket], link);
+
+	if (q->buckets[bucket].count == 0)
+	{
+		q->bitmap &= ~(1ULL << bucket);
+	}
+
+	q->count--;
+	return 1;
+}
+
+intrusive_link* bucket_queue_pop(bucket_queue* q)
+{
+	intrusive_link* link = bucket_queue_peek(q);
+	if (link)
+	{
+		bucket_queue_remove(q, link);
+	}
+
+	return link;
+}
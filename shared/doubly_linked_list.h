@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include "pool.h"
 
 typedef struct doubly_linked_list_node {
 	struct doubly_linked_list_node* next;
@@ -17,6 +18,8 @@ typedef struct doubly_linked_list
 	struct doubly_linked_list_node* head;
 	struct doubly_linked_list_node* tail;
 
+	// optional, nodes come from here instead of malloc
+	struct pool* node_pool;
 } doubly_linked_list;
 
 void doubly_linked_list_init(doubly_linked_list* ll)
@@ -25,6 +28,17 @@ void doubly_linked_list_init(doubly_linked_list* ll)
 		return;
 
 	ll->head = ll->tail = 0;
+	ll->node_pool = 0;
+}
+
+/// Inits a list whose nodes are taken from nodePool (block size >= sizeof(doubly_linked_list_node))
+void doubly_linked_list_init_pool(doubly_linked_list* ll, pool* nodePool)
+{
+	if (!ll)
+		return;
+
+	doubly_linked_list_init(ll);
+	ll->node_pool = nodePool;
 }
 
 void doubly_linked_list_free(doubly_linked_list* ll)
@@ -32,6 +46,13 @@ void doubly_linked_list_free(doubly_linked_list* ll)
 	if (!ll)
 		return;
 
+	if (ll->node_pool)
+	{
+		// nodes go away with the pool
+		ll->head = ll->tail = 0;
+		return;
+	}
+
 	// free all nodes
 	struct doubly_linked_list_node* n = ll->head;
 	while (n)
@@ -45,14 +66,29 @@ void doubly_linked_list_free(doubly_linked_list* ll)
 	}
 }
 
-void doubly_linked_list_add(doubly_linked_list* ll, void* value)
+/// Appends value, 0 if no node could be allocated
+int doubly_linked_list_add(doubly_linked_list* ll, void* value)
 {
 	if (!ll)
-		return;
+		return 0;
 
 	// create node
-	struct doubly_linked_list_node* node = (struct doubly_linked_list_node*)malloc(sizeof(doubly_linked_list_node));
-	memset(node, 0, sizeof(doubly_linked_list_node));
+	struct doubly_linked_list_node* node;
+	if (ll->node_pool)
+	{
+		// already zeroed
+		node = (struct doubly_linked_list_node*)pool_alloc(ll->node_pool);
+		if (!node)
+			return 0;
+	}
+	else
+	{
+		node = (struct doubly_linked_list_node*)malloc(sizeof(doubly_linked_list_node));
+		if (!node)
+			return 0;
+
+		memset(node, 0, sizeof(doubly_linked_list_node));
+	}
 
 	node->value = value;
 
@@ -68,6 +104,8 @@ void doubly_linked_list_add(doubly_linked_list* ll, void* value)
 
 		ll->tail = node;
 	}
+
+	return 1;
 }
 
 int doubly_linked_list_delete_node(doubly_linked_list* ll, doubly_linked_list_node* node)
@@ -100,7 +138,14 @@ int doubly_linked_list_delete_node(doubly_linked_list* ll, doubly_linked_list_no
 	}
 
 	// free node
-	free(node);
+	if (ll->node_pool)
+	{
+		pool_free(ll->node_pool, node);
+	}
+	else
+	{
+		free(node);
+	}
 
 	return 1;
 }
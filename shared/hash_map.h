@@ -0,0 +1,188 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+// grow once count exceeds capacity * 7 / 10
+#define HASH_MAP_MAX_LOAD_NUM 7
+#define HASH_MAP_MAX_LOAD_DEN 10
+
+typedef struct hash_map_slot
+{
+	int key;
+	int used;
+
+	void* value;
+} hash_map_slot;
+
+// open addressing int -> value map (linear probing, backward shift deletion)
+typedef struct hash_map
+{
+	struct hash_map_slot* slots;
+
+	// always a power of 2
+	int capacity;
+	int count;
+} hash_map;
+
+unsigned int hash_map_hash(int key)
+{
+	// murmur3 finalizer, pids are sequential so spread them out
+	unsigned int h = (unsigned int)key;
+	h ^= h >> 16;
+	h *= 0x85ebca6b;
+	h ^= h >> 13;
+	h *= 0xc2b2ae35;
+	h ^= h >> 16;
+
+	return h;
+}
+
+int hash_map_alloc(hash_map* map, int capacity)
+{
+	map->slots = (hash_map_slot*)malloc(sizeof(hash_map_slot) * capacity);
+	if (!map->slots)
+		return 0;
+
+	memset(map->slots, 0, sizeof(hash_map_slot) * capacity);
+
+	map->capacity = capacity;
+	map->count = 0;
+
+	return 1;
+}
+
+/// Inits the map sized so that expectedCount entries fit without rehashing
+int hash_map_init(hash_map* map, int expectedCount)
+{
+	if (!map)
+		return 0;
+
+	int capacity = 16;
+	while (capacity * HASH_MAP_MAX_LOAD_NUM < expectedCount * HASH_MAP_MAX_LOAD_DEN)
+	{
+		capacity *= 2;
+	}
+
+	return hash_map_alloc(map, capacity);
+}
+
+void hash_map_free(hash_map* map)
+{
+	if (!map)
+		return;
+
+	free(map->slots);
+
+	map->slots = 0;
+	map->capacity = 0;
+	map->count = 0;
+}
+
+// slot holding key, or the empty slot where it would go
+int hash_map_find_slot(hash_map* map, int key)
+{
+	int mask = map->capacity - 1;
+	int i = hash_map_hash(key) & mask;
+
+	while (map->slots[i].used && map->slots[i].key != key)
+	{
+		i = (i + 1) & mask;
+	}
+
+	return i;
+}
+
+int hash_map_put(hash_map* map, int key, void* value);
+
+int hash_map_grow(hash_map* map)
+{
+	hash_map old = *map;
+
+	if (!hash_map_alloc(map, old.capacity * 2))
+	{
+		*map = old;
+		return 0;
+	}
+
+	for (int i = 0; i < old.capacity; i++)
+	{
+		if (old.slots[i].used)
+		{
+			hash_map_put(map, old.slots[i].key, old.slots[i].value);
+		}
+	}
+
+	free(old.slots);
+	return 1;
+}
+
+/// Inserts or replaces key
+int hash_map_put(hash_map* map, int key, void* value)
+{
+	if (!map || !map->slots)
+		return 0;
+
+	if ((map->count + 1) * HASH_MAP_MAX_LOAD_DEN > map->capacity * HASH_MAP_MAX_LOAD_NUM)
+	{
+		if (!hash_map_grow(map))
+			return 0;
+	}
+
+	int i = hash_map_find_slot(map, key);
+	if (!map->slots[i].used)
+	{
+		map->slots[i].used = 1;
+		map->slots[i].key = key;
+		map->count++;
+	}
+
+	map->slots[i].value = value;
+	return 1;
+}
+
+void* hash_map_get(hash_map* map, int key)
+{
+	if (!map || !map->slots)
+		return 0;
+
+	int i = hash_map_find_slot(map, key);
+	return map->slots[i].used ? map->slots[i].value : 0;
+}
+
+int hash_map_remove(hash_map* map, int key)
+{
+	if (!map || !map->slots)
+		return 0;
+
+	int mask = map->capacity - 1;
+	int i = hash_map_find_slot(map, key);
+	if (!map->slots[i].used)
+		return 0;
+
+	// shift back following entries of the probe run so lookups never hit a hole
+	int j = i;
+	while (1)
+	{
+		j = (j + 1) & mask;
+		if (!map->slots[j].used)
+			break;
+
+		int home = hash_map_hash(map->slots[j].key) & mask;
+
+		// can j move into i? only if its home isn't cyclically in (i, j]
+		int movable = (i <= j) ? (home <= i || home > j) : (home <= i && home > j);
+		if (movable)
+		{
+			map->slots[i] = map->slots[j];
+			i = j;
+		}
+	}
+
+	map->slots[i].used = 0;
+	map->slots[i].value = 0;
+	map->count--;
+
+	return 1;
+}
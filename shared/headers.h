@@ -15,6 +15,11 @@
 #include <signal.h>
 #include "pri_queue.h"
 #include <errno.h>
+#include <string.h>
+#include <time.h>
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
 #ifndef _STD
 #define _STD ::std::
@@ -26,16 +31,77 @@ typedef short bool;
 
 #define SHKEY 300
 #define MSGKEY 400
+#define RINGKEY 500
+#define STATUSKEY 600
+#define POOLKEY 700
+#define METRICSKEY 800
 #define QUANTUM_TIME 2
 
+// default tick length, OS_TICK_US overrides it
+#define CLK_DEFAULT_PERIOD_US 1000000LL
+
+// the clock's shared segment
+typedef struct clk_shared {
+	// ticks since the clock started, 64-bit so fast clocks never wrap
+	volatile long long tick;
+
+	// tick length chosen at startup (0 until the clock is up)
+	volatile long long period_us;
+
+	// CLOCK_MONOTONIC time of tick 0, tick n lands at epoch_us + n * period_us
+	volatile long long epoch_us;
+
+	// low 32 bits of tick, futex word woken on every tick (see waitForTick)
+	volatile int tick_futex;
+} clk_shared;
+
 ///==============================
 // don't mess with this variable//
-int* shmaddr; //
+clk_shared* shmaddr; //
 //===============================
 
+long long getClk64()
+{
+	return __atomic_load_n(&shmaddr->tick, __ATOMIC_ACQUIRE);
+}
+
 int getClk()
 {
-	return *shmaddr;
+	return (int)getClk64();
+}
+
+long long getClkPeriodUs()
+{
+	return shmaddr->period_us;
+}
+
+// CLOCK_MONOTONIC time (us) at which the clock reaches tick
+long long getClkTickTimeUs(long long tick)
+{
+	return shmaddr->epoch_us + tick * shmaddr->period_us;
+}
+
+/*
+ * Blocks until the clock reaches target and returns the current time.
+ * Sleeps on the clock's futex word, so the caller wakes on the tick itself instead of polling.
+ */
+int waitForTick(int target)
+{
+	while (1)
+	{
+		// read the word before the tick, a tick in between makes FUTEX_WAIT return at once
+		int seen = __atomic_load_n(&shmaddr->tick_futex, __ATOMIC_ACQUIRE);
+
+		int now = getClk();
+		if (now >= target)
+			return now;
+
+		// no clock process behind shmaddr (simulation), nobody would wake us
+		if (getClkPeriodUs() == 0)
+			return now;
+
+		syscall(SYS_futex, &shmaddr->tick_futex, FUTEX_WAIT, seen, NULL, NULL, 0);
+	}
 }
 
 /*
@@ -44,15 +110,25 @@ int getClk()
  */
 void initClk()
 {
-	int shmid = shmget(SHKEY, 4, 0444);
-	while ((int)shmid == -1)
+	int shmid = shmget(SHKEY, sizeof(clk_shared), 0444);
+	if ((int)shmid == -1)
 	{
 		// Make sure that the clock exists
 		printf("Wait! The clock not initialized yet!\n");
-		sleep(1);
-		shmid = shmget(SHKEY, 4, 0444);
 	}
-	shmaddr = (int*)shmat(shmid, (void*)0, 0);
+	while ((int)shmid == -1)
+	{
+		// retry quickly, a whole second is many ticks on a fast clock
+		usleep(10 * 1000);
+		shmid = shmget(SHKEY, sizeof(clk_shared), 0444);
+	}
+	shmaddr = (clk_shared*)shmat(shmid, (void*)0, 0);
+
+	// segment exists but the clock may not have started ticking yet
+	while (__atomic_load_n(&shmaddr->period_us, __ATOMIC_ACQUIRE) == 0)
+	{
+		usleep(1000);
+	}
 }
 
 /*
@@ -75,6 +151,95 @@ void destroyClk(bool terminateAll)
 
 // our stuff
 
+/*
+ * Optional knobs are read from the environment, so every program forked from
+ * the generator sees the same settings without extra argv plumbing.
+ */
+const char* get_env_option(const char* name, const char* fallback)
+{
+	const char* value = getenv(name);
+	return (value && value[0]) ? value : fallback;
+}
+
+int get_env_option_int(const char* name, int fallback)
+{
+	const char* value = getenv(name);
+	return (value && value[0]) ? atoi(value) : fallback;
+}
+
+// wall clock in microseconds, for measuring (not simulating) time
+long long monotonic_time_us()
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+/*
+ * Creates (create) or attaches a shared memory segment, 0 on failure, name only shows up in errors.
+ * The creator drops a leftover segment from a crashed run first (it may be too small) and gets it zeroed.
+ * A read-only attach of a segment that doesn't exist yet fails quietly, the caller may retry.
+ */
+void* shared_segment_attach(key_t key, size_t size, bool create, bool readOnly, const char* name)
+{
+	char error[64];
+
+	if (create)
+	{
+		int old = shmget(key, 0, 0666);
+		if (old != -1)
+		{
+			shmctl(old, IPC_RMID, NULL);
+		}
+	}
+
+	int shmid = shmget(key, create ? size : 0, create ? (IPC_CREAT | 0666) : (readOnly ? 0444 : 0666));
+	if (shmid == -1)
+	{
+		if (!readOnly || errno != ENOENT)
+		{
+			snprintf(error, sizeof(error), "Error in %s shmget", name);
+			perror(error);
+		}
+
+		return 0;
+	}
+
+	void* addr = shmat(shmid, (void*)0, readOnly ? SHM_RDONLY : 0);
+	if ((long)addr == -1)
+	{
+		snprintf(error, sizeof(error), "Error in %s shmat", name);
+		perror(error);
+		return 0;
+	}
+
+	if (create)
+	{
+		memset(addr, 0, size);
+	}
+
+	return addr;
+}
+
+/// Detaches addr, destroy also removes the segment under key
+void shared_segment_detach(void* addr, key_t key, bool destroy)
+{
+	if (!addr)
+		return;
+
+	shmdt(addr);
+
+	if (destroy)
+	{
+		int shmid = shmget(key, 0, 0666);
+		if (shmid != -1)
+		{
+			shmctl(shmid, IPC_RMID, NULL);
+		}
+	}
+}
+
 // process data as read from file
 typedef struct process_data {
 	int id;
@@ -83,11 +248,279 @@ typedef struct process_data {
 	int priority;
 } process_data;
 
-typedef struct process_message_buffer {
+// all arrivals of a tick travel together, bigger bursts are split
+#define PROCESS_BATCH_MAX 256
+
+typedef struct process_batch_message_buffer {
 	long type;
-	struct process_data data;
-} process_message_buffer;
+
+	int count;
+	struct process_data data[PROCESS_BATCH_MAX];
+} process_batch_message_buffer;
+
+// generator -> scheduler transports, OS_TRANSPORT=ring|msgq
+#define PROCESS_TRANSPORT_RING 0
+#define PROCESS_TRANSPORT_MSGQ 1
+
+int get_process_transport()
+{
+	const char* transport = get_env_option("OS_TRANSPORT", "ring");
+	return strcmp(transport, "msgq") == 0 ? PROCESS_TRANSPORT_MSGQ : PROCESS_TRANSPORT_RING;
+}
+
+// must be a power of 2
+#define PROCESS_RING_CAPACITY 4096
+
+/*
+ * Single producer (generator) / single consumer (scheduler) ring of process_data in shared memory.
+ * Each side only writes its own index, published with release stores, so no locks are needed.
+ * Indices run freely and are masked on access.
+ */
+typedef struct process_ring {
+	// written by the producer
+	unsigned int tail;
+	char tail_pad[60];
+
+	// written by the consumer
+	unsigned int head;
+	char head_pad[60];
+
+	process_data slots[PROCESS_RING_CAPACITY];
+} process_ring;
+
+/// Attaches the ring, the generator creates it (and resets it)
+process_ring* process_ring_attach(bool create)
+{
+	int shmid = shmget(RINGKEY, sizeof(process_ring), create ? (IPC_CREAT | 0666) : 0666);
+	if (shmid == -1)
+	{
+		perror("Error in ring shmget");
+		return 0;
+	}
+
+	process_ring* ring = (process_ring*)shmat(shmid, (void*)0, 0);
+	if ((long)ring == -1)
+	{
+		perror("Error in ring shmat");
+		return 0;
+	}
+
+	if (create)
+	{
+		ring->head = 0;
+		ring->tail = 0;
+	}
+
+	return ring;
+}
+
+void process_ring_detach(process_ring* ring, bool destroy)
+{
+	if (!ring)
+		return;
+
+	shmdt(ring);
+
+	if (destroy)
+	{
+		int shmid = shmget(RINGKEY, sizeof(process_ring), 0666);
+		if (shmid != -1)
+		{
+			shmctl(shmid, IPC_RMID, NULL);
+		}
+	}
+}
+
+/// Copies up to count entries in, returns how many fit
+int process_ring_publish(process_ring* ring, process_data* items, int count)
+{
+	unsigned int tail = ring->tail;
+	unsigned int head = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+
+	int space = PROCESS_RING_CAPACITY - (int)(tail - head);
+	if (count > space)
+	{
+		count = space;
+	}
+
+	for (int i = 0; i < count; i++)
+	{
+		ring->slots[(tail + i) & (PROCESS_RING_CAPACITY - 1)] = items[i];
+	}
+
+	// make the slots visible before the new tail
+	__atomic_store_n(&ring->tail, tail + count, __ATOMIC_RELEASE);
+
+	return count;
+}
+
+/// Copies up to max entries out, returns how many were taken
+int process_ring_consume(process_ring* ring, process_data* out, int max)
+{
+	unsigned int head = ring->head;
+	unsigned int tail = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+
+	int available = (int)(tail - head);
+	if (available > max)
+	{
+		available = max;
+	}
+
+	for (int i = 0; i < available; i++)
+	{
+		out[i] = ring->slots[(head + i) & (PROCESS_RING_CAPACITY - 1)];
+	}
+
+	// slots can be reused by the producer from now on
+	__atomic_store_n(&ring->head, head + available, __ATOMIC_RELEASE);
+
+	return available;
+}
+
+/*
+ * Per-process status shared between the scheduler and its processes, one slot per process.
+ * A process publishes its remaining time every tick and the scheduler reads it when it needs it,
+ * so no update can get lost the way coalesced per-tick signals did.
+ */
+typedef struct process_status {
+	volatile int remaining_time;
+
+	// last tick the process accounted for (decrement or resume), futex word woken after each decrement
+	volatile int updated_at;
+} process_status;
+
+/// Attaches the status table, the scheduler creates it with count slots, processes attach with 0
+process_status* process_status_attach(int count, bool create)
+{
+	return (process_status*)shared_segment_attach(STATUSKEY, sizeof(process_status) * (count > 0 ? count : 1), create, false, "status");
+}
+
+void process_status_detach(process_status* table, bool destroy)
+{
+	shared_segment_detach(table, STATUSKEY, destroy);
+}
+
+/*
+ * Mailbox of a pre-forked worker process (OS_PROCESS_POOL).
+ * The scheduler fills in a job and bumps job_seq, the worker sleeps on job_seq as a futex.
+ */
+typedef struct process_pool_slot {
+	volatile int job_seq;
+
+	int remaining_time;
+	int status_slot;
+
+	// set once with the last job_seq bump, the worker exits
+	int shutdown;
+
+	// set by the worker once it's attached and waiting
+	volatile int ready;
+} process_pool_slot;
+
+/// Attaches the worker mailboxes, the scheduler creates count of them, workers attach with 0
+process_pool_slot* process_pool_attach(int count, bool create)
+{
+	return (process_pool_slot*)shared_segment_attach(POOLKEY, sizeof(process_pool_slot) * (count > 0 ? count : 1), create, false, "pool");
+}
+
+void process_pool_detach(process_pool_slot* slots, bool destroy)
+{
+	shared_segment_detach(slots, POOLKEY, destroy);
+}
+
+// generator -> scheduler "new processes in the msg queue" wakeup
+// real-time so notifications queue instead of coalescing
+#define SIGNAL_PROCESS_ARRIVAL SIGRTMIN
+
+// pooled worker -> scheduler "job done", carries the worker index (workers don't exit, so no SIGCHLD)
+#define SIGNAL_PROCESS_DONE (SIGRTMIN + 1)
+
+/*
+ * Signals the scheduler consumes through its event loop (signalfd) instead of handlers.
+ * They have to stay blocked from the moment the scheduler is exec'd.
+ */
+void scheduler_event_signals(sigset_t* set)
+{
+	sigemptyset(set);
+	sigaddset(set, SIGINT);
+	sigaddset(set, SIGTERM);
+	sigaddset(set, SIGCHLD);
+	sigaddset(set, SIGNAL_PROCESS_ARRIVAL);
+	sigaddset(set, SIGNAL_PROCESS_DONE);
+}
+
+/*
+ * Reads processes.txt into a queue ordered by arrival time (incase the file isn't sorted).
+ * Queued values are malloc'd process_data.
+ */
+int read_processes(pri_queue* processes, int* count) {
+	if (count) {
+		*count = 0;
+	}
+
+	if (!processes)
+		return 0;
+
+	FILE* f = fopen("processes.txt", "r");
+	if (!f)
+	{
+		// invalid file?
+		return 0;
+	}
+
+	char* line = 0;
+	size_t lineLen = 0;
+	while (getline(&line, &lineLen, f) != EOF)
+	{
+		// we have a line :P
+		// ignore empty lines or lines that start with #
+		if (lineLen == 0 ||
+			strlen(line) == 0 ||
+			line[0] == '#')
+			continue;
+
+		// allocate process
+		struct process_data* p = malloc(sizeof(process_data));
+		memset(p, 0, sizeof(process_data));
+
+		// read proc data
+		sscanf(line, "%d%d%d%d", &p->id, &p->arrival_time, &p->running_time, &p->priority);
+
+		// insert in queue
+		pri_queue_enqueue(processes, p->arrival_time, p);
+		printf("Process with id %d, arrivaltime %d, remainingtime %d, priority %d\n", p->id, p->arrival_time, p->running_time, p->priority);
+
+		if (count) {
+			(*count)++;
+		}
+	}
+
+	// close file
+	fclose(f);
+
+	// free line
+	if (line)
+	{
+		free(line);
+	}
+
+	return 1;
+}
+
+// OS_SIMULATE=1, the scheduler runs the whole trace as a discrete-event simulation
+bool is_simulation_mode()
+{
+	return get_env_option_int("OS_SIMULATE", 0) != 0;
+}
+
+// pcb states, also what scheduler.log & traces record
+#define PROCESS_STATE_RDY 0
+#define PROCESS_STATE_STARTED 1
+#define PROCESS_STATE_TERMINATED 2
+#define PROCESS_STATE_RESUMED 3
 
 #define SCHEDULING_ALGO_HPF 0
 #define SCHEDULING_ALGO_SRTN 1
-#define SCHEDULING_ALGO_RR 2
\ No newline at end of file
+#define SCHEDULING_ALGO_RR 2
+#define SCHEDULING_ALGO_MLFQ 3
+#define SCHEDULING_ALGO_CFS 4
@@ -0,0 +1,141 @@
+#pragma once
+
+#include <stddef.h>
+
+// embed this in the struct that should be linked, no separate node allocation
+typedef struct intrusive_link
+{
+	struct intrusive_link* next;
+	struct intrusive_link* prev;
+
+	// list we're currently in, 0 when unlinked
+	struct intrusive_list* owner;
+} intrusive_link;
+
+// doubly linked FIFO of embedded links
+typedef struct intrusive_list
+{
+	struct intrusive_link* head;
+	struct intrusive_link* tail;
+
+	int count;
+} intrusive_list;
+
+// struct containing the link
+#define intrusive_list_entry(link, type, member) ((type*)((char*)(link) - offsetof(type, member)))
+
+void intrusive_list_init(intrusive_list* list)
+{
+	if (!list)
+		return;
+
+	list->head = list->tail = 0;
+	list->count = 0;
+}
+
+void intrusive_link_init(intrusive_link* link)
+{
+	if (!link)
+		return;
+
+	link->next = link->prev = 0;
+	link->owner = 0;
+}
+
+int intrusive_link_is_linked(intrusive_link* link)
+{
+	return link && link->owner;
+}
+
+void intrusive_list_push_back(intrusive_list* list, intrusive_link* link)
+{
+	if (!list || !link || link->owner)
+		return;
+
+	link->next = 0;
+	link->prev = list->tail;
+	link->owner = list;
+
+	if (list->tail)
+	{
+		list->tail->next = link;
+	}
+	else
+	{
+		list->head = link;
+	}
+
+	list->tail = link;
+	list->count++;
+}
+
+void intrusive_list_push_front(intrusive_list* list, intrusive_link* link)
+{
+	if (!list || !link || link->owner)
+		return;
+
+	link->prev = 0;
+	link->next = list->head;
+	link->owner = list;
+
+	if (list->head)
+	{
+		list->head->prev = link;
+	}
+	else
+	{
+		list->tail = link;
+	}
+
+	list->head = link;
+	list->count++;
+}
+
+/// Unlinks link from its list, O(1)
+int intrusive_list_remove(intrusive_list* list, intrusive_link* link)
+{
+	if (!list || !link || link->owner != list)
+		return 0;
+
+	if (link->prev)
+	{
+		link->prev->next = link->next;
+	}
+	else
+	{
+		list->head = link->next;
+	}
+
+	if (link->next)
+	{
+		link->next->prev = link->prev;
+	}
+	else
+	{
+		list->tail = link->prev;
+	}
+
+	intrusive_link_init(link);
+	list->count--;
+
+	return 1;
+}
+
+intrusive_link* intrusive_list_peek_front(intrusive_list* list)
+{
+	if (!list)
+		return 0;
+
+	return list->head;
+}
+
+intrusive_link* intrusive_list_pop_front(intrusive_list* list)
+{
+	if (!list || !list->head)
+		return 0;
+
+	intrusive_link* link = list->head;
+	intrusive_list_remove(list, link);
+
+	return link;
+}
@@ -0,0 +1,229 @@
+#pragma once
+
+#include "headers.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <stdarg.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <time.h>
+#include <errno.h>
+
+#define LOG_WRITER_DEFAULT_BUFFER (64 * 1024)
+#define LOG_WRITER_DEFAULT_FLUSH_US 1000000LL
+
+// keeps a file open and batches lines in a userspace buffer, one write(2) per flush
+typedef struct log_writer
+{
+	int fd;
+
+	char* buffer;
+	size_t size;
+	size_t used;
+
+	// flush once the oldest buffered line is this old, 0 = only when full
+	long long flush_interval_us;
+	long long first_pending_us;
+
+	struct {
+		long lines;
+		long flushes;
+		long long bytes;
+	} stats;
+} log_writer;
+
+/// Opens (truncates) path, returns 0 on failure
+int log_writer_open(log_writer* w, const char* path, size_t bufferSize, long long flushIntervalUs)
+{
+	if (!w)
+		return 0;
+
+	memset(w, 0, sizeof(log_writer));
+	w->fd = -1;
+
+	w->buffer = (char*)malloc(bufferSize);
+	if (!w->buffer)
+		return 0;
+
+	w->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+	if (w->fd == -1)
+	{
+		perror("Cannot open log");
+
+		free(w->buffer);
+		w->buffer = 0;
+		return 0;
+	}
+
+	w->size = bufferSize;
+	w->flush_interval_us = flushIntervalUs;
+
+	return 1;
+}
+
+void log_writer_write_all(log_writer* w, const char* data, size_t len)
+{
+	while (len > 0)
+	{
+		ssize_t written = write(w->fd, data, len);
+		if (written == -1)
+		{
+			if (errno == EINTR)
+				continue;
+
+			perror("Log write failure");
+			return;
+		}
+
+		data += written;
+		len -= written;
+		w->stats.bytes += written;
+	}
+}
+
+void log_writer_flush(log_writer* w)
+{
+	if (!w || w->fd == -1 || w->used == 0)
+		return;
+
+	log_writer_write_all(w, w->buffer, w->used);
+
+	w->used = 0;
+	w->stats.flushes++;
+}
+
+/// Time based flush, call it from the main loop so quiet periods still reach the file
+void log_writer_poll(log_writer* w)
+{
+	if (!w || w->used == 0 || w->flush_interval_us <= 0)
+		return;
+
+	if (monotonic_time_us() - w->first_pending_us >= w->flush_interval_us)
+	{
+		log_writer_flush(w);
+	}
+}
+
+/// How long a poller may sleep before the time based flush is due, in ms (-1 = nothing pending)
+int log_writer_poll_timeout_ms(log_writer* w)
+{
+	if (!w || w->used == 0 || w->flush_interval_us <= 0)
+		return -1;
+
+	long long left = w->first_pending_us + w->flush_interval_us - monotonic_time_us();
+	if (left <= 0)
+		return 0;
+
+	// round up, waking early would only spin until it's due
+	return (int)((left + 999) / 1000);
+}
+
+/// Appends raw bytes (binary records), flushing first if they don't fit
+void log_writer_write(log_writer* w, const void* data, size_t len)
+{
+	if (!w || w->fd == -1)
+		return;
+
+	if (len > w->size - w->used)
+	{
+		log_writer_flush(w);
+
+		if (len > w->size)
+		{
+			log_writer_write_all(w, (const char*)data, len);
+			return;
+		}
+	}
+
+	if (w->used == 0)
+	{
+		w->first_pending_us = monotonic_time_us();
+	}
+
+	memcpy(w->buffer + w->used, data, len);
+	w->used += len;
+
+	log_writer_poll(w);
+}
+
+/// Appends one formatted line (or any text), flushing first if it doesn't fit
+void log_writer_printf(log_writer* w, const char* format, ...)
+{
+	if (!w || w->fd == -1)
+		return;
+
+	if (w->used == 0)
+	{
+		w->first_pending_us = monotonic_time_us();
+	}
+
+	va_list args;
+	va_start(args, format);
+	int len = vsnprintf(w->buffer + w->used, w->size - w->used, format, args);
+	va_end(args);
+
+	if (len < 0)
+		return;
+
+	if ((size_t)len >= w->size - w->used)
+	{
+		// didn't fit, make room and format again
+		log_writer_flush(w);
+		w->first_pending_us = monotonic_time_us();
+
+		va_start(args, format);
+		len = vsnprintf(w->buffer, w->size, format, args);
+		va_end(args);
+
+		if ((size_t)len >= w->size)
+		{
+			// bigger than the whole buffer, write it straight through
+			char* line = (char*)malloc(len + 1);
+			if (!line)
+				return;
+
+			va_start(args, format);
+			vsnprintf(line, len + 1, format, args);
+			va_end(args);
+
+			log_writer_write_all(w, line, len);
+			free(line);
+
+			w->stats.lines++;
+			return;
+		}
+	}
+
+	w->used += len;
+	w->stats.lines++;
+
+	log_writer_poll(w);
+}
+
+/// Flushes whatever is left and closes the file
+void log_writer_close(log_writer* w)
+{
+	if (!w)
+		return;
+
+	log_writer_flush(w);
+
+	if (w->fd != -1)
+	{
+		close(w->fd);
+		w->fd = -1;
+	}
+
+	free(w->buffer);
+	w->buffer = 0;
+}
+
+void print_log_writer_stats(log_writer* w, const char* name)
+{
+	if (!w)
+		return;
+
+	printf("[Log] %s: lines=%ld flushes=%ld bytes=%lld\n", name, w->stats.lines, w->stats.flushes, w->stats.bytes);
+}
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "headers.h"
+
+#include <sched.h>
+
+/*
+ * Live scheduler metrics (OS_METRICS=1), one shared page written by the scheduler.
+ * The scheduler republishes it once per loop iteration, readers (metrics_reader) poll it
+ * without any locking on the scheduler side: seq is odd while a snapshot is being written.
+ */
+
+// dispatch latency buckets, bucket 0 = under 1 us, bucket i = [2^(i-1), 2^i) us, the last one is open
+#define METRICS_LATENCY_BUCKETS 16
+
+typedef struct metrics_page {
+	volatile unsigned int seq;
+
+	// 0 once the scheduler is done, the page is gone after the readers detach
+	int active;
+
+	int algorithm;
+	int processes_count;
+
+	int tick;
+
+	int ready_queue_length;
+
+	// simulated cpus (OS_CPUS) and how many run something
+	int cpus;
+	int busy_cpus;
+
+	// lowest busy cpu's process, -1 = all idle
+	int running_pid;
+
+	long long context_switches;
+	long long dispatch_latency[METRICS_LATENCY_BUCKETS];
+
+	long long arrivals;
+	long long terminations;
+
+	// during tick only
+	int tick_arrivals;
+	int tick_terminations;
+
+	// cpu ticks spent running something since tick 0, utilization is over all cpus
+	long long busy_ticks;
+	float utilization;
+} metrics_page;
+
+int metrics_latency_bucket(long long latencyUs)
+{
+	int bucket = 0;
+
+	while (latencyUs > 0 && bucket < METRICS_LATENCY_BUCKETS - 1)
+	{
+		latencyUs >>= 1;
+		bucket++;
+	}
+
+	return bucket;
+}
+
+/// Creates (scheduler) or attaches read-only (readers) the page, 0 on failure
+metrics_page* metrics_attach(bool create)
+{
+	return (metrics_page*)shared_segment_attach(METRICSKEY, sizeof(metrics_page), create, !create, "metrics");
+}
+
+void metrics_detach(metrics_page* page, bool destroy)
+{
+	shared_segment_detach(page, METRICSKEY, destroy);
+}
+
+/// Copies snapshot into the page, single writer
+void metrics_publish(metrics_page* page, metrics_page* snapshot)
+{
+	if (!page)
+		return;
+
+	unsigned int seq = page->seq;
+
+	__atomic_store_n(&page->seq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+
+	snapshot->seq = seq + 1;
+	memcpy(page, snapshot, sizeof(metrics_page));
+
+	__atomic_store_n(&page->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+/// Takes a consistent copy of the page, retries while the scheduler is mid-write
+void metrics_read(metrics_page* page, metrics_page* out)
+{
+	while (1)
+	{
+		unsigned int seq = __atomic_load_n(&page->seq, __ATOMIC_ACQUIRE);
+		if (seq & 1)
+		{
+			sched_yield();
+			continue;
+		}
+
+		memcpy(out, page, sizeof(metrics_page));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+		if (__atomic_load_n(&page->seq, __ATOMIC_RELAXED) == seq)
+		{
+			out->seq = seq;
+			return;
+		}
+	}
+}
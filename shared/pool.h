@@ -0,0 +1,158 @@
+#pragma once
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define POOL_DEFAULT_BLOCKS_PER_CHUNK 256
+
+typedef struct pool_chunk
+{
+	struct pool_chunk* next;
+
+	// blocks follow the header
+} pool_chunk;
+
+// free blocks are threaded through their own first bytes
+typedef struct pool_free_block
+{
+	struct pool_free_block* next;
+} pool_free_block;
+
+// fixed-size block allocator, everything is released at once by pool_destroy
+typedef struct pool
+{
+	size_t block_size;
+	int blocks_per_chunk;
+
+	struct pool_chunk* chunks;
+	struct pool_free_block* free_list;
+
+	// next never-used block in the newest chunk
+	char* bump;
+	char* bump_end;
+
+	struct {
+		long allocations;
+		long frees;
+		long chunk_mallocs;
+		long in_use;
+		long peak_in_use;
+	} stats;
+} pool;
+
+void pool_init(pool* p, size_t blockSize, int blocksPerChunk)
+{
+	if (!p)
+		return;
+
+	memset(p, 0, sizeof(pool));
+
+	// blocks must be able to hold the free list link and stay pointer aligned
+	if (blockSize < sizeof(pool_free_block))
+	{
+		blockSize = sizeof(pool_free_block);
+	}
+
+	p->block_size = (blockSize + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+	p->blocks_per_chunk = blocksPerChunk > 0 ? blocksPerChunk : POOL_DEFAULT_BLOCKS_PER_CHUNK;
+}
+
+/// Releases every block of the pool in one go (per-run arena teardown)
+void pool_destroy(pool* p)
+{
+	if (!p)
+		return;
+
+	pool_chunk* c = p->chunks;
+	while (c)
+	{
+		pool_chunk* next = c->next;
+		free(c);
+		c = next;
+	}
+
+	p->chunks = 0;
+	p->free_list = 0;
+	p->bump = p->bump_end = 0;
+	p->stats.in_use = 0;
+}
+
+/// Returns a zeroed block
+void* pool_alloc(pool* p)
+{
+	if (!p)
+		return 0;
+
+	void* block;
+	if (p->free_list)
+	{
+		// recycle
+		block = p->free_list;
+		p->free_list = p->free_list->next;
+	}
+	else
+	{
+		if (p->bump == p->bump_end)
+		{
+			// new chunk
+			size_t header = (sizeof(pool_chunk) + sizeof(void*) - 1) & ~(sizeof(void*) - 1);
+			pool_chunk* c = (pool_chunk*)malloc(header + p->block_size * p->blocks_per_chunk);
+			if (!c)
+				return 0;
+
+			c->next = p->chunks;
+			p->chunks = c;
+
+			p->bump = (char*)c + header;
+			p->bump_end = p->bump + p->block_size * p->blocks_per_chunk;
+
+			p->stats.chunk_mallocs++;
+		}
+
+		block = p->bump;
+		p->bump += p->block_size;
+	}
+
+	memset(block, 0, p->block_size);
+
+	p->stats.allocations++;
+	p->stats.in_use++;
+	if (p->stats.in_use > p->stats.peak_in_use)
+	{
+		p->stats.peak_in_use = p->stats.in_use;
+	}
+
+	return block;
+}
+
+void pool_free(pool* p, void* block)
+{
+	if (!p || !block)
+		return;
+
+	pool_free_block* b = (pool_free_block*)block;
+	b->next = p->free_list;
+	p->free_list = b;
+
+	p->stats.frees++;
+	p->stats.in_use--;
+}
+
+/// mallocs (and matching frees) the pool saved compared to one malloc per block
+long pool_allocations_avoided(pool* p)
+{
+	if (!p)
+		return 0;
+
+	return p->stats.allocations - p->stats.chunk_mallocs;
+}
+
+void print_pool_stats(pool* p, const char* name)
+{
+	if (!p)
+		return;
+
+	printf("[Pool] %s: allocs=%ld frees=%ld peak=%ld chunk mallocs=%ld avoided=%ld\n",
+		name, p->stats.allocations, p->stats.frees, p->stats.peak_in_use, p->stats.chunk_mallocs, pool_allocations_avoided(p));
+}
@@ -4,19 +4,30 @@
 #include <string.h>
 #include <stdio.h>
 
-typedef struct pri_queue_node
-{
-	struct pri_queue_node* next;
-	struct pri_queue_node* prev;
+#define PRI_QUEUE_INITIAL_CAPACITY 16
 
+typedef struct pri_queue_entry
+{
 	int priority;
+
+	// insertion order, breaks ties so equal priorities stay FIFO
+	unsigned long long sequence;
+
 	void* value;
-} pri_queue_node;
 
-// priority queue
+	// optional, kept equal to the entry's index (-1 once it leaves the queue)
+	int* handle;
+} pri_queue_entry;
+
+// priority queue (binary min-heap)
 typedef struct pri_queue
 {
-	struct pri_queue_node* head;
+	struct pri_queue_entry* entries;
+
+	int count;
+	int capacity;
+
+	unsigned long long next_sequence;
 } pri_queue;
 
 void pri_queue_init(pri_queue* q)
@@ -24,7 +35,10 @@ void pri_queue_init(pri_queue* q)
 	if (!q)
 		return;
 
-	q->head = 0;
+	q->entries = 0;
+	q->count = 0;
+	q->capacity = 0;
+	q->next_sequence = 0;
 }
 
 void pri_queue_free(pri_queue* q)
@@ -32,110 +46,205 @@ void pri_queue_free(pri_queue* q)
 	if (!q)
 		return;
 
-	// free all nodes
-	struct pri_queue_node* n = q->head;
-	while (n)
+	// detach handles of anything still queued
+	for (int i = 0; i < q->count; i++)
 	{
-		struct pri_queue_node* next = n->next;
+		if (q->entries[i].handle)
+		{
+			*q->entries[i].handle = -1;
+		}
+	}
 
-		// delete
-		free(n);
+	// entries live in one block
+	free(q->entries);
 
-		n = next;
-	}
+	pri_queue_init(q);
 }
 
-void pri_queue_enqueue(pri_queue* q, int priority, void* value)
+// does a come out before b?
+int pri_queue_entry_before(pri_queue_entry* a, pri_queue_entry* b)
 {
-	if (!q)
-		return;
+	if (a->priority != b->priority)
+		return a->priority < b->priority;
 
-	// create node
-	struct pri_queue_node* node = (struct pri_queue_node*)malloc(sizeof(pri_queue_node));
-	memset(node, 0, sizeof(pri_queue_node));
+	return a->sequence < b->sequence;
+}
 
-	node->priority = priority;
-	node->value = value;
+void pri_queue_set(pri_queue* q, int i, pri_queue_entry* entry)
+{
+	q->entries[i] = *entry;
 
-	// insert
-	if (!q->head)
+	if (entry->handle)
 	{
-		q->head = node;
-		return;
+		*entry->handle = i;
 	}
+}
 
-	struct pri_queue_node* current = q->head;
-	while (current)
+void pri_queue_swap(pri_queue* q, int i, int j)
+{
+	pri_queue_entry tmp = q->entries[i];
+	pri_queue_set(q, i, &q->entries[j]);
+	pri_queue_set(q, j, &tmp);
+}
+
+void pri_queue_sift_up(pri_queue* q, int i)
+{
+	while (i > 0)
 	{
-		if (current->priority > priority)
-		{
-			// insert here
-			node->next = current;
-			node->prev = current->prev;
-
-			if (current->prev)
-			{
-				current->prev->next = node;
-			}
-			current->prev = node;
-
-			if (current == q->head)
-			{
-				q->head = node;
-			}
-
-			return;
-		}
+		int parent = (i - 1) / 2;
+		if (!pri_queue_entry_before(&q->entries[i], &q->entries[parent]))
+			break;
 
-		// not inserted yet, and next is null
-		if (!current->next)
-		{
-			node->prev = current;
-			current->next = node;
+		pri_queue_swap(q, i, parent);
+		i = parent;
+	}
+}
 
-			return;
-		}
+void pri_queue_sift_down(pri_queue* q, int i)
+{
+	while (1)
+	{
+		int left = 2 * i + 1;
+		int right = left + 1;
+		int smallest = i;
+
+		if (left < q->count && pri_queue_entry_before(&q->entries[left], &q->entries[smallest]))
+			smallest = left;
+
+		if (right < q->count && pri_queue_entry_before(&q->entries[right], &q->entries[smallest]))
+			smallest = right;
 
-		current = current->next;
+		if (smallest == i)
+			break;
+
+		pri_queue_swap(q, i, smallest);
+		i = smallest;
 	}
 }
 
-int pri_queue_dequeue(pri_queue* q, void** value)
+int pri_queue_reserve(pri_queue* q, int capacity)
 {
-	if (!q || !q->head)
+	if (capacity <= q->capacity)
+		return 1;
+
+	int newCapacity = q->capacity ? q->capacity : PRI_QUEUE_INITIAL_CAPACITY;
+	while (newCapacity < capacity)
+	{
+		newCapacity *= 2;
+	}
+
+	pri_queue_entry* entries = (pri_queue_entry*)realloc(q->entries, sizeof(pri_queue_entry) * newCapacity);
+	if (!entries)
 		return 0;
 
-	struct pri_queue_node* n = q->head;
+	q->entries = entries;
+	q->capacity = newCapacity;
+
+	return 1;
+}
+
+/// Enqueues value and keeps *handle pointing at its slot for pri_queue_update/pri_queue_remove
+void pri_queue_enqueue_handle(pri_queue* q, int priority, void* value, int* handle)
+{
+	if (!q)
+		return;
+
+	// grow storage (amortized, no per-node alloc)
+	if (!pri_queue_reserve(q, q->count + 1))
+	{
+		perror("pri_queue out of memory");
+		return;
+	}
 
-	// update head
-	q->head = n->next;
+	pri_queue_entry* entry = &q->entries[q->count];
+	entry->priority = priority;
+	entry->sequence = q->next_sequence++;
+	entry->value = value;
+	entry->handle = handle;
 
-	// update prev
-	if (q->head)
+	if (handle)
 	{
-		q->head->prev = 0;
+		*handle = q->count;
 	}
 
+	q->count++;
+
+	pri_queue_sift_up(q, q->count - 1);
+}
+
+void pri_queue_enqueue(pri_queue* q, int priority, void* value)
+{
+	pri_queue_enqueue_handle(q, priority, value, 0);
+}
+
+/// Removes the entry at handle, O(log n)
+int pri_queue_remove(pri_queue* q, int handle, void** value)
+{
+	if (!q || handle < 0 || handle >= q->count)
+		return 0;
+
+	pri_queue_entry* entry = &q->entries[handle];
+
 	if (value)
 	{
-		*value = n->value;
+		*value = entry->value;
 	}
 
-	// free node
-	free(n);
+	if (entry->handle)
+	{
+		*entry->handle = -1;
+	}
+
+	// fill the hole with the last entry, which may need to move either way
+	q->count--;
+	if (handle < q->count)
+	{
+		pri_queue_set(q, handle, &q->entries[q->count]);
+
+		pri_queue_sift_up(q, handle);
+		pri_queue_sift_down(q, handle);
+	}
 
 	return 1;
 }
 
+/// Changes the priority of the entry at handle (decrease or increase key), O(log n)
+/// FIFO position among equal priorities is kept from the original enqueue
+int pri_queue_update(pri_queue* q, int handle, int priority)
+{
+	if (!q || handle < 0 || handle >= q->count)
+		return 0;
+
+	int old = q->entries[handle].priority;
+	q->entries[handle].priority = priority;
+
+	if (priority < old)
+	{
+		pri_queue_sift_up(q, handle);
+	}
+	else if (priority > old)
+	{
+		pri_queue_sift_down(q, handle);
+	}
+
+	return 1;
+}
+
+int pri_queue_dequeue(pri_queue* q, void** value)
+{
+	if (!q || q->count == 0)
+		return 0;
+
+	return pri_queue_remove(q, 0, value);
+}
+
 void print_pri_queue(pri_queue* q)
 {
+	// heap order, not sorted
 	printf("Queue: [ ");
-	struct pri_queue_node* n = q->head;
-	while (n)
+	for (int i = 0; i < q->count; i++)
 	{
-		printf("%d ", n->priority);
-		//*(int *)n->value
-		n = n->next;
+		printf("%d ", q->entries[i].priority);
 	}
 
 	printf("]\n");
@@ -143,21 +252,25 @@ void print_pri_queue(pri_queue* q)
 
 int pri_queue_peek(pri_queue* q, void** result)
 {
-	if (!q || !q->head || !result) return 0;
+	if (!q || q->count == 0 || !result) return 0;
 
-	*result = q->head->value;
+	*result = q->entries[0].value;
 	return 1;
 }
 
+int pri_queue_count(pri_queue* q)
+{
+	if (!q) return 0;
+
+	return q->count;
+}
+
+/// Visits every queued value in heap order (not sorted by priority)
 void pri_queue_iterate(pri_queue* q, void(*callback)(void*, void*), void* param) {
-	if (!q || !callback || !q->head) return;
+	if (!q || !callback || q->count == 0) return;
 
-	pri_queue_node* node = q->head;
-	while (node) {
+	for (int i = 0; i < q->count; i++) {
 		// invoke callback
-		callback(node->value, param);
-
-		// proceed
-		node = node->next;
+		callback(q->entries[i].value, param);
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,359 @@
+#pragma once
+
+#include <stddef.h>
+
+// embed this in the struct that should be in the tree, no separate node allocation
+typedef struct rb_node
+{
+	struct rb_node* left;
+	struct rb_node* right;
+
+	// points to itself while not in a tree
+	struct rb_node* parent;
+
+	int red;
+} rb_node;
+
+// red-black tree of embedded nodes, ordered by the less callback given to insert
+typedef struct rb_tree
+{
+	struct rb_node* root;
+
+	// smallest node, cached so first is O(1)
+	struct rb_node* leftmost;
+
+	int count;
+} rb_tree;
+
+// struct containing the node
+#define rb_tree_entry(node, type, member) ((type*)((char*)(node) - offsetof(type, member)))
+
+void rb_tree_init(rb_tree* tree)
+{
+	if (!tree)
+		return;
+
+	tree->root = tree->leftmost = 0;
+	tree->count = 0;
+}
+
+void rb_node_init(rb_node* node)
+{
+	if (!node)
+		return;
+
+	node->left = node->right = 0;
+	node->parent = node;
+	node->red = 0;
+}
+
+int rb_node_is_linked(rb_node* node)
+{
+	return node && node->parent != node;
+}
+
+void rb_tree_rotate_left(rb_tree* tree, rb_node* x)
+{
+	rb_node* y = x->right;
+
+	x->right = y->left;
+	if (y->left)
+		y->left->parent = x;
+
+	y->parent = x->parent;
+	if (!x->parent)
+		tree->root = y;
+	else if (x == x->parent->left)
+		x->parent->left = y;
+	else
+		x->parent->right = y;
+
+	y->left = x;
+	x->parent = y;
+}
+
+void rb_tree_rotate_right(rb_tree* tree, rb_node* x)
+{
+	rb_node* y = x->left;
+
+	x->left = y->right;
+	if (y->right)
+		y->right->parent = x;
+
+	y->parent = x->parent;
+	if (!x->parent)
+		tree->root = y;
+	else if (x == x->parent->right)
+		x->parent->right = y;
+	else
+		x->parent->left = y;
+
+	y->right = x;
+	x->parent = y;
+}
+
+/// In-order successor, 0 for the last node
+rb_node* rb_tree_next(rb_node* node)
+{
+	if (node->right)
+	{
+		node = node->right;
+		while (node->left)
+			node = node->left;
+
+		return node;
+	}
+
+	while (node->parent && node == node->parent->right)
+		node = node->parent;
+
+	return node->parent;
+}
+
+rb_node* rb_tree_first(rb_tree* tree)
+{
+	return tree ? tree->leftmost : 0;
+}
+
+/// Inserts node, equal keys go after the ones already in the tree (FIFO), O(log n)
+void rb_tree_insert(rb_tree* tree, rb_node* node, int (*less)(rb_node*, rb_node*))
+{
+	rb_node* parent = 0;
+	rb_node** link = &tree->root;
+	int leftmost = 1;
+
+	while (*link)
+	{
+		parent = *link;
+
+		if (less(node, parent))
+		{
+			link = &parent->left;
+		}
+		else
+		{
+			link = &parent->right;
+			leftmost = 0;
+		}
+	}
+
+	node->parent = parent;
+	node->left = node->right = 0;
+	node->red = 1;
+	*link = node;
+
+	if (leftmost)
+		tree->leftmost = node;
+
+	tree->count++;
+
+	// restore the red-black rules
+	while (node->parent && node->parent->red)
+	{
+		rb_node* p = node->parent;
+
+		// a red parent is never the root
+		rb_node* g = p->parent;
+
+		if (p == g->left)
+		{
+			rb_node* uncle = g->right;
+
+			if (uncle && uncle->red)
+			{
+				p->red = uncle->red = 0;
+				g->red = 1;
+				node = g;
+				continue;
+			}
+
+			if (node == p->right)
+			{
+				node = p;
+				rb_tree_rotate_left(tree, node);
+				p = node->parent;
+			}
+
+			p->red = 0;
+			g->red = 1;
+			rb_tree_rotate_right(tree, g);
+		}
+		else
+		{
+			rb_node* uncle = g->left;
+
+			if (uncle && uncle->red)
+			{
+				p->red = uncle->red = 0;
+				g->red = 1;
+				node = g;
+				continue;
+			}
+
+			if (node == p->left)
+			{
+				node = p;
+				rb_tree_rotate_right(tree, node);
+				p = node->parent;
+			}
+
+			p->red = 0;
+			g->red = 1;
+			rb_tree_rotate_left(tree, g);
+		}
+	}
+
+	tree->root->red = 0;
+}
+
+// puts v where u was (v may be 0)
+void rb_tree_transplant(rb_tree* tree, rb_node* u, rb_node* v)
+{
+	if (!u->parent)
+		tree->root = v;
+	else if (u == u->parent->left)
+		u->parent->left = v;
+	else
+		u->parent->right = v;
+
+	if (v)
+		v->parent = u->parent;
+}
+
+/// Unlinks node from the tree, O(log n)
+int rb_tree_remove(rb_tree* tree, rb_node* node)
+{
+	if (!tree || !rb_node_is_linked(node))
+		return 0;
+
+	if (tree->leftmost == node)
+		tree->leftmost = rb_tree_next(node);
+
+	// x takes the place of the removed black node (may be 0, hence xParent)
+	rb_node* x;
+	rb_node* xParent;
+	int removedRed = node->red;
+
+	if (!node->left)
+	{
+		x = node->right;
+		xParent = node->parent;
+		rb_tree_transplant(tree, node, node->right);
+	}
+	else if (!node->right)
+	{
+		x = node->left;
+		xParent = node->parent;
+		rb_tree_transplant(tree, node, node->left);
+	}
+	else
+	{
+		// two children, the successor moves up into node's place
+		rb_node* y = node->right;
+		while (y->left)
+			y = y->left;
+
+		removedRed = y->red;
+		x = y->right;
+
+		if (y->parent == node)
+		{
+			xParent = y;
+		}
+		else
+		{
+			xParent = y->parent;
+			rb_tree_transplant(tree, y, y->right);
+
+			y->right = node->right;
+			y->right->parent = y;
+		}
+
+		rb_tree_transplant(tree, node, y);
+
+		y->left = node->left;
+		y->left->parent = y;
+		y->red = node->red;
+	}
+
+	// a black node is gone, fix the black heights
+	while (!removedRed && x != tree->root && (!x || !x->red))
+	{
+		if (x == xParent->left)
+		{
+			rb_node* w = xParent->right;
+
+			if (w->red)
+			{
+				w->red = 0;
+				xParent->red = 1;
+				rb_tree_rotate_left(tree, xParent);
+				w = xParent->right;
+			}
+
+			if ((!w->left || !w->left->red) && (!w->right || !w->right->red))
+			{
+				w->red = 1;
+				x = xParent;
+				xParent = x->parent;
+				continue;
+			}
+
+			if (!w->right || !w->right->red)
+			{
+				w->left->red = 0;
+				w->red = 1;
+				rb_tree_rotate_right(tree, w);
+				w = xParent->right;
+			}
+
+			w->red = xParent->red;
+			xParent->red = 0;
+			w->right->red = 0;
+			rb_tree_rotate_left(tree, xParent);
+			x = tree->root;
+		}
+		else
+		{
+			rb_node* w = xParent->left;
+
+			if (w->red)
+			{
+				w->red = 0;
+				xParent->red = 1;
+				rb_tree_rotate_right(tree, xParent);
+				w = xParent->left;
+			}
+
+			if ((!w->left || !w->left->red) && (!w->right || !w->right->red))
+			{
+				w->red = 1;
+				x = xParent;
+				xParent = x->parent;
+				continue;
+			}
+
+			if (!w->left || !w->left->red)
+			{
+				w->right->red = 0;
+				w->red = 1;
+				rb_tree_rotate_left(tree, w);
+				w = xParent->left;
+			}
+
+			w->red = xParent->red;
+			xParent->red = 0;
+			w->left->red = 0;
+			rb_tree_rotate_right(tree, xParent);
+			x = tree->root;
+		}
+	}
+
+	if (x)
+		x->red = 0;
+
+	tree->count--;
+	rb_node_init(node);
+
+	return 1;
+}
@@ -0,0 +1,149 @@
+#pragma once
+
+#include "headers.h"
+#include "log_writer.h"
+#include "running_stats.h"
+
+/*
+ * scheduler.log & scheduler.perf formatting, shared by the scheduler and trace_convert
+ * so a converted trace reads exactly like a text log of the same run.
+ */
+
+const char* report_state_name(int state)
+{
+	switch (state) {
+	case PROCESS_STATE_RDY:
+		return "stopped";
+
+	case PROCESS_STATE_STARTED:
+		return "started";
+
+	case PROCESS_STATE_RESUMED:
+		return "resumed";
+
+	case PROCESS_STATE_TERMINATED:
+		return "finished";
+
+	default:
+		return "";
+	}
+}
+
+float report_weighted_turnaround_time(int turnaroundTime, int runningTime)
+{
+	if (runningTime == 0) return -1;
+
+	return turnaroundTime / (float)runningTime;
+}
+
+/// One scheduler.log line, finished processes also get TA & WTA
+void report_log_event(log_writer* w, int tick, int pid, int state, int arrivalTime, int runningTime, int remainingTime, int waitingTime)
+{
+	if (state == PROCESS_STATE_TERMINATED) {
+		int turnaround = tick - arrivalTime;
+
+		log_writer_printf(w, "At time %d\tprocess %d\t%s   arr %d   total %d   remain %d   wait %d   TA %d   WTA %.2f\n",
+			tick, pid, report_state_name(state), arrivalTime, runningTime, remainingTime, waitingTime,
+			turnaround, report_weighted_turnaround_time(turnaround, runningTime));
+	}
+	else {
+		log_writer_printf(w, "At time %d\tprocess %d\t%s   arr %d   total %d   remain %d   wait %d\n",
+			tick, pid, report_state_name(state), arrivalTime, runningTime, remainingTime, waitingTime);
+	}
+}
+
+// everything scheduler.perf shows
+typedef struct perf_report {
+	float utilization;
+	float avg_wta;
+	float avg_waiting;
+	float std_wta;
+	float avg_turnaround;
+
+	long context_switches;
+	long long context_switch_total_us;
+	long long context_switch_max_us;
+
+	long creations;
+	long long creation_total_us;
+	long long creation_max_us;
+
+	// 0 = no process pool
+	int pool_workers;
+	long long pool_startup_us;
+
+	// per-cpu lines only show up with more than one cpu
+	int cpu_count;
+	float* cpu_utilization;
+} perf_report;
+
+int report_write_perf(const char* path, perf_report* r)
+{
+	FILE* f = fopen(path, "w");
+	if (!f) {
+		perror("Cannot open perf report");
+		return 0;
+	}
+
+	fprintf(f, "CPU Utilization = %.2f%%\nAvg WTA = %.2f\nAvg Waiting = %.2f\nStd WTA = %.2f\nAvg TA = %.2f\n",
+		r->utilization * 100.f, r->avg_wta, r->avg_waiting, r->std_wta, r->avg_turnaround);
+
+	float avgSwitch = r->context_switches > 0 ? r->context_switch_total_us / (float)r->context_switches : 0.f;
+	fprintf(f, "Context Switches = %ld\nAvg Context Switch Latency = %.1f us\nMax Context Switch Latency = %lld us\n",
+		r->context_switches, avgSwitch, r->context_switch_max_us);
+
+	float avgCreation = r->creations > 0 ? r->creation_total_us / (float)r->creations : 0.f;
+	fprintf(f, "Avg Process Creation Cost = %.1f us\nMax Process Creation Cost = %lld us\n", avgCreation, r->creation_max_us);
+
+	if (r->pool_workers > 0) {
+		fprintf(f, "Process Pool Workers = %d\nProcess Pool Startup = %lld us\n", r->pool_workers, r->pool_startup_us);
+	}
+
+	if (r->cpu_count > 1 && r->cpu_utilization) {
+		for (int i = 0; i < r->cpu_count; i++) {
+			fprintf(f, "CPU %d Utilization = %.2f%%\n", i, r->cpu_utilization[i] * 100.f);
+		}
+	}
+
+	fclose(f);
+	return 1;
+}
+
+// per-termination aggregates, scheduler.perf can be produced at any moment in O(1)
+typedef struct perf_totals {
+	running_stats wta;
+	running_stats waiting;
+	running_stats turnaround;
+
+	// running time of every finished process, the cpu was busy for that long
+	long long busy_ticks;
+} perf_totals;
+
+void perf_totals_init(perf_totals* t)
+{
+	running_stats_init(&t->wta);
+	running_stats_init(&t->waiting);
+	running_stats_init(&t->turnaround);
+
+	t->busy_ticks = 0;
+}
+
+/// Feeds one finished process
+void perf_totals_add(perf_totals* t, int turnaroundTime, int waitingTime, int runningTime)
+{
+	running_stats_add(&t->wta, report_weighted_turnaround_time(turnaroundTime, runningTime));
+	running_stats_add(&t->waiting, waitingTime);
+	running_stats_add(&t->turnaround, turnaroundTime);
+
+	t->busy_ticks += runningTime;
+}
+
+/// Fills the process part of the report as of clock, utilization is over all cpus
+void perf_totals_report(perf_totals* t, int clock, int cpuCount, perf_report* r)
+{
+	r->utilization = clock > 0 ? t->busy_ticks / ((float)clock * cpuCount) : 0.f;
+	r->avg_wta = running_stats_mean(&t->wta);
+	r->avg_waiting = running_stats_mean(&t->waiting);
+	r->std_wta = running_stats_stddev(&t->wta);
+	r->avg_turnaround = running_stats_mean(&t->turnaround);
+}
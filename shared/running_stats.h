@@ -0,0 +1,52 @@
+#pragma once
+
+#include <math.h>
+
+// streaming mean & variance (Welford), O(1) per sample, no samples kept
+typedef struct running_stats
+{
+	long count;
+
+	double mean;
+
+	// sum of squared distances from the mean
+	double m2;
+} running_stats;
+
+void running_stats_init(running_stats* s)
+{
+	if (!s)
+		return;
+
+	s->count = 0;
+	s->mean = 0.0;
+	s->m2 = 0.0;
+}
+
+void running_stats_add(running_stats* s, double value)
+{
+	if (!s)
+		return;
+
+	s->count++;
+
+	double delta = value - s->mean;
+	s->mean += delta / s->count;
+	s->m2 += delta * (value - s->mean);
+}
+
+double running_stats_mean(running_stats* s)
+{
+	return (s && s->count > 0) ? s->mean : 0.0;
+}
+
+/// Population variance (divides by count), what scheduler.perf has always reported
+double running_stats_variance(running_stats* s)
+{
+	return (s && s->count > 0) ? s->m2 / s->count : 0.0;
+}
+
+double running_stats_stddev(running_stats* s)
+{
+	return sqrt(running_stats_variance(s));
+}
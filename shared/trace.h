@@ -0,0 +1,131 @@
+#pragma once
+
+#include "log_writer.h"
+
+/*
+ * Binary scheduler trace (OS_TRACE=1): a file header followed by fixed-size records.
+ * trace_convert turns it back into scheduler.log & scheduler.perf.
+ */
+
+#define TRACE_MAGIC "OSTRACE"
+#define TRACE_VERSION 1
+
+typedef struct trace_file_header {
+	char magic[8];
+
+	int version;
+	int record_size;
+} trace_file_header;
+
+// a process was admitted (pid, process)
+#define TRACE_RECORD_PROCESS 1
+
+// a log line (pid, event)
+#define TRACE_RECORD_EVENT 2
+
+// a latency counter at exit (pid = TRACE_COUNTER_*, counter)
+#define TRACE_RECORD_COUNTER 3
+
+// clock at exit (event.tick), last record of a complete trace
+#define TRACE_RECORD_END 4
+
+#define TRACE_COUNTER_CONTEXT_SWITCH 0
+#define TRACE_COUNTER_PROCESS_CREATION 1
+
+// count = workers, total_us = startup
+#define TRACE_COUNTER_PROCESS_POOL 2
+
+// one per cpu, count = cpu, total_us = busy ticks, max_us = cpu count
+#define TRACE_COUNTER_CPU 3
+
+typedef struct trace_record {
+	int type;
+	int pid;
+
+	union {
+		struct {
+			int tick;
+			int state;
+			int remaining_time;
+			int waiting_time;
+		} event;
+
+		struct {
+			int arrival_time;
+			int running_time;
+			int priority;
+		} process;
+
+		struct {
+			long long count;
+			long long total_us;
+			long long max_us;
+		} counter;
+	};
+} trace_record;
+
+void trace_write_header(log_writer* w)
+{
+	trace_file_header header;
+	memset(&header, 0, sizeof(header));
+
+	memcpy(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC));
+	header.version = TRACE_VERSION;
+	header.record_size = sizeof(trace_record);
+
+	log_writer_write(w, &header, sizeof(header));
+}
+
+void trace_write_process(log_writer* w, int pid, int arrivalTime, int runningTime, int priority)
+{
+	trace_record r;
+	memset(&r, 0, sizeof(r));
+
+	r.type = TRACE_RECORD_PROCESS;
+	r.pid = pid;
+	r.process.arrival_time = arrivalTime;
+	r.process.running_time = runningTime;
+	r.process.priority = priority;
+
+	log_writer_write(w, &r, sizeof(r));
+}
+
+void trace_write_event(log_writer* w, int tick, int pid, int state, int remainingTime, int waitingTime)
+{
+	trace_record r;
+	memset(&r, 0, sizeof(r));
+
+	r.type = TRACE_RECORD_EVENT;
+	r.pid = pid;
+	r.event.tick = tick;
+	r.event.state = state;
+	r.event.remaining_time = remainingTime;
+	r.event.waiting_time = waitingTime;
+
+	log_writer_write(w, &r, sizeof(r));
+}
+
+void trace_write_counter(log_writer* w, int id, long long count, long long totalUs, long long maxUs)
+{
+	trace_record r;
+	memset(&r, 0, sizeof(r));
+
+	r.type = TRACE_RECORD_COUNTER;
+	r.pid = id;
+	r.counter.count = count;
+	r.counter.total_us = totalUs;
+	r.counter.max_us = maxUs;
+
+	log_writer_write(w, &r, sizeof(r));
+}
+
+void trace_write_end(log_writer* w, int tick)
+{
+	trace_record r;
+	memset(&r, 0, sizeof(r));
+
+	r.type = TRACE_RECORD_END;
+	r.event.tick = tick;
+
+	log_writer_write(w, &r, sizeof(r));
+}
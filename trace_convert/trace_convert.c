@@ -0,0 +1,207 @@
+/*
+* Offline converter for binary scheduler traces (OS_TRACE=1).
+* Renders the scheduler.log text and computes scheduler.perf exactly like the scheduler would have.
+*
+* Usage: ./trace_convert.out [trace=scheduler.trace] [log=scheduler.log] [perf=scheduler.perf]
+*/
+
+#include "headers.h"
+#include "hash_map.h"
+#include "log_writer.h"
+#include "report.h"
+#include "trace.h"
+
+// what the scheduler's pcb would hold at exit
+typedef struct converted_process {
+	int pid;
+	int arrival_time;
+	int running_time;
+
+	// -1 if it never finished
+	int finish;
+	int waiting_time;
+} converted_process;
+
+// fed at every finished event, like the scheduler's terminate_process
+perf_totals perf_stats;
+
+// admission order, same order as the scheduler's process table
+converted_process* processes;
+int processes_count;
+int processes_capacity;
+
+// pid -> index + 1
+hash_map process_index;
+
+// busy ticks of every cpu, from the TRACE_COUNTER_CPU records
+long long* cpu_busy_ticks;
+int cpu_count = 1;
+
+converted_process* add_process(trace_record* r) {
+	if (processes_count == processes_capacity) {
+		processes_capacity = processes_capacity ? processes_capacity * 2 : 64;
+		processes = (converted_process*)realloc(processes, sizeof(converted_process) * processes_capacity);
+		if (!processes) {
+			perror("Out of memory");
+			exit(EXIT_FAILURE);
+		}
+	}
+
+	converted_process* p = &processes[processes_count++];
+	p->pid = r->pid;
+	p->arrival_time = r->process.arrival_time;
+	p->running_time = r->process.running_time;
+	p->finish = -1;
+	p->waiting_time = 0;
+
+	hash_map_put(&process_index, r->pid, (void*)(long)processes_count);
+	return p;
+}
+
+converted_process* find_process(int pid) {
+	long index = (long)hash_map_get(&process_index, pid);
+	return index ? &processes[index - 1] : 0;
+}
+
+int main(int argc, char** argv) {
+	const char* tracePath = argc > 1 ? argv[1] : "scheduler.trace";
+	const char* logPath = argc > 2 ? argv[2] : "scheduler.log";
+	const char* perfPath = argc > 3 ? argv[3] : "scheduler.perf";
+
+	FILE* f = fopen(tracePath, "rb");
+	if (!f) {
+		printf("Usage: %s [trace] [log] [perf]\n", argv[0]);
+		perror("Cannot open trace");
+		return 1;
+	}
+
+	trace_file_header header;
+	if (fread(&header, sizeof(header), 1, f) != 1 || memcmp(header.magic, TRACE_MAGIC, sizeof(TRACE_MAGIC)) != 0) {
+		printf("[Convert] %s is not a scheduler trace\n", tracePath);
+		fclose(f);
+		return 1;
+	}
+
+	if (header.version != TRACE_VERSION || header.record_size != sizeof(trace_record)) {
+		printf("[Convert] Unsupported trace version %d (record size %d)\n", header.version, header.record_size);
+		fclose(f);
+		return 1;
+	}
+
+	log_writer log;
+	if (!log_writer_open(&log, logPath, LOG_WRITER_DEFAULT_BUFFER, 0)) {
+		fclose(f);
+		return 1;
+	}
+
+	hash_map_init(&process_index, 1024);
+
+	perf_totals_init(&perf_stats);
+
+	perf_report report;
+	memset(&report, 0, sizeof(report));
+
+	int clock = -1;
+	long records = 0;
+
+	trace_record batch[1024];
+	size_t read;
+	while ((read = fread(batch, sizeof(trace_record), 1024, f)) > 0) {
+		for (size_t i = 0; i < read; i++) {
+			trace_record* r = &batch[i];
+			records++;
+
+			switch (r->type) {
+			case TRACE_RECORD_PROCESS:
+				add_process(r);
+				break;
+
+			case TRACE_RECORD_EVENT: {
+				converted_process* p = find_process(r->pid);
+				if (!p) {
+					printf("[Convert] Event for unknown process %d at record %ld\n", r->pid, records);
+					break;
+				}
+
+				p->waiting_time = r->event.waiting_time;
+				if (r->event.state == PROCESS_STATE_TERMINATED) {
+					p->finish = r->event.tick;
+					perf_totals_add(&perf_stats, p->finish - p->arrival_time, p->waiting_time, p->running_time);
+				}
+
+				report_log_event(&log, r->event.tick, r->pid, r->event.state, p->arrival_time, p->running_time, r->event.remaining_time, r->event.waiting_time);
+				break;
+			}
+
+			case TRACE_RECORD_COUNTER:
+				if (r->pid == TRACE_COUNTER_CONTEXT_SWITCH) {
+					report.context_switches = r->counter.count;
+					report.context_switch_total_us = r->counter.total_us;
+					report.context_switch_max_us = r->counter.max_us;
+				}
+				else if (r->pid == TRACE_COUNTER_PROCESS_CREATION) {
+					report.creations = r->counter.count;
+					report.creation_total_us = r->counter.total_us;
+					report.creation_max_us = r->counter.max_us;
+				}
+				else if (r->pid == TRACE_COUNTER_PROCESS_POOL) {
+					report.pool_workers = (int)r->counter.count;
+					report.pool_startup_us = r->counter.total_us;
+				}
+				else if (r->pid == TRACE_COUNTER_CPU) {
+					if (!cpu_busy_ticks) {
+						cpu_count = (int)r->counter.max_us;
+						cpu_busy_ticks = (long long*)calloc(cpu_count, sizeof(long long));
+					}
+
+					if (cpu_busy_ticks && r->counter.count >= 0 && r->counter.count < cpu_count) {
+						cpu_busy_ticks[r->counter.count] = r->counter.total_us;
+					}
+				}
+				break;
+
+			case TRACE_RECORD_END:
+				clock = r->event.tick;
+				break;
+
+			default:
+				printf("[Convert] Unknown record type %d at record %ld\n", r->type, records);
+				break;
+			}
+		}
+	}
+
+	fclose(f);
+	log_writer_close(&log);
+
+	printf("[Convert] %ld records, %d processes -> %s\n", records, processes_count, logPath);
+
+	if (clock == -1) {
+		// the scheduler died before writing its summary
+		printf("[Convert] Trace has no end record, skipping %s\n", perfPath);
+	}
+	else {
+		perf_totals_report(&perf_stats, clock, cpu_count, &report);
+
+		float* cpuUtilization = (float*)malloc(sizeof(float) * cpu_count);
+		if (cpuUtilization && cpu_busy_ticks) {
+			for (int i = 0; i < cpu_count; i++) {
+				cpuUtilization[i] = clock > 0 ? cpu_busy_ticks[i] / (float)clock : 0.f;
+			}
+
+			report.cpu_count = cpu_count;
+			report.cpu_utilization = cpuUtilization;
+		}
+
+		report_write_perf(perfPath, &report);
+		free(cpuUtilization);
+
+		printf("[Convert] -> %s\n", perfPath);
+	}
+
+	hash_map_free(&process_index);
+	free(processes);
+	free(cpu_busy_ticks);
+
+	return 0;
+}